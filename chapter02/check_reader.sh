@@ -0,0 +1,100 @@
+#!/bin/sh
+###############################################################################
+#  Title          : check_reader.sh
+#  Author         : Stewart Weiss
+#  Created on     : October 16, 2026
+#  Description    : Checks that utmp_reader frames records correctly however
+#                   the data arrives
+#  Usage          : check_reader.sh        (run by "make check")
+#
+#  Notes          : A file written by gen_wtmp is fed to show_utmp through a
+#                   pipe by chunk_feed, in chunks of fixed and random sizes
+#                   that do not end on record boundaries, with several read
+#                   buffer sizes, and the output must be byte for byte what
+#                   show_utmp prints when it reads the file itself. Then a
+#                   file that ends part way into a record is read, and
+#                   records are appended in pieces to a file that show_utmp
+#                   --follow is watching.
+#                   The files are written in a directory under TMPDIR, which
+#                   is removed at the end. The exit status is the number of
+#                   checks that failed.
+#
+###############################################################################
+# Copyright (C) 2020 - Stewart Weiss
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+###############################################################################
+
+RECSIZE=384                     # sizeof(struct utmp) on Linux
+dir=$(mktemp -d "${TMPDIR:-/tmp}/check_readerXXXXXX") || exit 1
+trap 'rm -rf "$dir"' EXIT
+failed=0
+
+# check NAME EXPECTED ACTUAL: reports whether the two files are the same
+check() {
+    if cmp -s "$2" "$3"; then
+        echo "PASS  $1"
+    else
+        echo "FAIL  $1"
+        failed=$((failed + 1))
+    fi
+}
+
+./gen_wtmp -s 3 2000 "$dir/small" || exit 1
+./gen_wtmp -s 4 -j 500 20000 "$dir/large" || exit 1
+./show_utmp "$dir/small" > "$dir/small.out"
+./show_utmp "$dir/large" > "$dir/large.out"
+
+# fixed chunk sizes, including a byte at a time and just either side of
+# the record size
+for sizes in 1 7 383 385 1000,3,5000; do
+    ./chunk_feed "$sizes" "$dir/small" | ./show_utmp /dev/stdin > "$dir/got"
+    check "pipe in chunks of $sizes bytes" "$dir/small.out" "$dir/got"
+done
+
+# random chunk sizes, with read buffers of one record and of sizes that
+# are not multiples of the record size
+for bufsize in 384 1000 4096 65536; do
+    ./chunk_feed -r 7 random "$dir/large" \
+        | UTMP_BUFSIZE=$bufsize ./show_utmp /dev/stdin > "$dir/got"
+    check "pipe in random chunks, UTMP_BUFSIZE=$bufsize" \
+          "$dir/large.out" "$dir/got"
+done
+
+# a partial record at the end is not shown, whether the file is piped,
+# read through a buffer, or read backward
+cp "$dir/small" "$dir/partial"
+head -c 100 "$dir/large" >> "$dir/partial"
+./chunk_feed 1000 "$dir/partial" | ./show_utmp /dev/stdin > "$dir/got"
+check "pipe with a partial last record" "$dir/small.out" "$dir/got"
+./wtmp_merge "$dir/partial" > "$dir/got"       # never maps the file
+check "buffered file with a partial last record" "$dir/small.out" "$dir/got"
+./show_utmp -n 3 "$dir/partial" > "$dir/got"
+tail -n 3 "$dir/small.out" > "$dir/expected"
+check "-n 3 with a partial last record" "$dir/expected" "$dir/got"
+
+# records appended in pieces to a file being followed are each shown once
+head -c $((5 * RECSIZE)) "$dir/large" > "$dir/five"
+./show_utmp "$dir/five" > "$dir/expected"
+cp "$dir/small" "$dir/followed"
+./show_utmp --follow "$dir/followed" > "$dir/got" &
+follower=$!
+sleep 1
+./chunk_feed -d 200000 100,400,500 "$dir/five" >> "$dir/followed"
+sleep 1
+kill $follower
+wait $follower 2>/dev/null
+check "--follow with records appended in pieces" "$dir/expected" "$dir/got"
+
+exit $failed
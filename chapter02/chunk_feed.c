@@ -0,0 +1,166 @@
+/******************************************************************************
+  Title          : chunk_feed.c
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Copies a file to the standard output in chunks of odd sizes
+  Purpose        : To feed utmp records to a reader through a pipe, or append
+                   them to a file, in pieces that do not end on record
+                   boundaries, so that the reader's framing can be tested
+  Usage          : chunk_feed [-r seed] [-d usec] sizes [file]
+                   where sizes is a comma-separated list of chunk sizes in
+                   bytes, such as 1000,3,5000, which are used in turn, or
+                   "random" for sizes from 1 to MAX_RANDOM_CHUNK bytes
+                   chosen with the given seed (1). Each chunk is written
+                   with its own write(), after a pause of usec microseconds
+                   (0), so that a reader at the other end of a pipe sees
+                   the pieces one at a time. The file is the standard input
+                   if it is not given.
+  Build with     : gcc -o chunk_feed chunk_feed.c -I../include -L../lib -lutils
+
+  Notes          : With the standard output opened for appending, as by the
+                   shell's >>, each chunk is appended to the end of the file
+                   as it is written, the way a slow writer appends a record
+                   in pieces.
+
+******************************************************************************
+ * Copyright (C) 2020 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "utils.h"
+
+#define MAX_RANDOM_CHUNK  5000      /* largest random chunk, in bytes */
+#define MAX_SIZES         64        /* most sizes in the list */
+
+
+/*****************************************************************************
+  next_random( state )
+  returns the next number of the xorshift64* sequence in *state
+ *****************************************************************************/
+static unsigned long long next_random( unsigned long long * );
+
+/*****************************************************************************
+  write_all( fd, buf, n )
+  writes all n bytes of buf to fd, dying if it cannot
+ *****************************************************************************/
+static void write_all( int, const char *, size_t );
+
+
+/*****************************************************************************
+                               Main Program
+*****************************************************************************/
+int main(int argc, char* argv[])
+{
+    size_t              sizes[MAX_SIZES];   /* the chunk sizes, in turn */
+    int                 nsizes = 0;         /* 0 for random sizes */
+    unsigned long long  state  = 1;         /* of the random sizes */
+    long                pause  = 0;         /* microseconds between chunks */
+    char               *buf, *p, *end;
+    size_t              have, chunk;
+    ssize_t             n;
+    int                 fd = 0, ch, i = 0;
+
+    while ( (ch = getopt(argc, argv, "r:d:")) != -1 ) {
+        switch ( ch ) {
+        case 'r':
+            state = strtoull(optarg, NULL, 10);
+            break;
+        case 'd':
+            pause = atol(optarg);
+            break;
+        default:
+            optind = argc;          /* to print the usage message */
+            break;
+        }
+    }
+    if ( optind >= argc ) {
+        fprintf(stderr, "usage: %s [-r seed] [-d usec] sizes [file]\n",
+                argv[0]);
+        exit(1);
+    }
+    if ( strcmp(argv[optind], "random") != 0 )
+        for ( p = argv[optind]; *p != '\0' && nsizes < MAX_SIZES; p = end ) {
+            sizes[nsizes] = strtoul(p, &end, 10);
+            if ( end == p || sizes[nsizes] == 0 || (*end != ',' && *end != '\0') )
+                die("Bad chunk size list ", argv[optind]);
+            nsizes++;
+            if ( *end == ',' )
+                end++;
+        }
+    if ( state == 0 )
+        state = 1;                  /* xorshift never leaves 0 */
+    if ( optind + 1 < argc && (fd = open(argv[optind + 1], O_RDONLY)) == -1 )
+        die("Cannot open ", argv[optind + 1]);
+
+    if ( (buf = malloc(MAX_RANDOM_CHUNK)) == NULL )
+        die("Out of memory", "");
+    have = MAX_RANDOM_CHUNK;
+    for ( ;; ) {
+        chunk = nsizes > 0 ? sizes[i++ % nsizes]
+                           : 1 + next_random(&state) % MAX_RANDOM_CHUNK;
+        if ( chunk > have ) {
+            /* make room for the chunk; only a listed size can be bigger */
+            if ( (p = realloc(buf, chunk)) == NULL )
+                die("Out of memory", "");
+            buf  = p;
+            have = chunk;
+        }
+        /* a short read from a pipe is not the end; fill the chunk */
+        for ( n = 0, end = buf; end < buf + chunk; end += n )
+            if ( (n = read(fd, end, buf + chunk - end)) <= 0 )
+                break;
+        if ( n < 0 )
+            die("Cannot read input", "");
+        if ( end > buf ) {
+            if ( pause > 0 )
+                usleep(pause);
+            write_all(1, buf, end - buf);
+        }
+        if ( end < buf + chunk )
+            break;                  /* the end of the input */
+    }
+    free(buf);
+    return 0;
+}
+
+
+static unsigned long long next_random( unsigned long long *state )
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+
+static void write_all( int fd, const char *buf, size_t n )
+{
+    ssize_t  written;
+
+    while ( n > 0 ) {
+        if ( (written = write(fd, buf, n)) <= 0 )
+            die("Cannot write output", "");
+        buf += written;
+        n   -= written;
+    }
+}
@@ -0,0 +1,160 @@
+/******************************************************************************
+  Title          : column_bench.c
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Compares scanning a wtmp file with next_utmp() against
+                   scanning the same records in a columnar file
+  Purpose        : To show how much less work a scan does when it reads only
+                   the fields it needs
+  Usage          : column_bench <wtmp-file> [columns-file]
+                   If no columns-file is given, the wtmp file is converted
+                   into a temporary one, which is removed at the end.
+  Build with     : gcc -o column_bench column_bench.c utmp_utils.c \
+                   -I../include -L../lib -lutils -lz -lpthread
+
+  Notes          : Every scan adds up ut_type and ut_tv.tv_sec of every
+                   record, and the sums are printed so that they can be seen
+                   to agree. The "columns" scan reads the two arrays it
+                   needs; the "records" scan rebuilds each whole record from
+                   the columnar file, for comparison. Run it twice in a row
+                   to see the numbers for files that are in the page cache.
+
+******************************************************************************
+ * Copyright (C) 2020 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "utmp_utils.h"
+#include "utils.h"
+
+/*****************************************************************************
+  elapsed( start )  returns the seconds since start
+ *****************************************************************************/
+double elapsed( struct timespec * );
+
+/*****************************************************************************
+  report( name, bytes, count, secs, sum )  prints one line of results
+ *****************************************************************************/
+void report( char *, long long, long, double, long long );
+
+
+/*****************************************************************************
+                               Main Program
+*****************************************************************************/
+int main(int argc, char* argv[])
+{
+    char             tmp[] = "/tmp/column_benchXXXXXX";
+    char            *columns_file;
+    utmp_columns    *cols;
+    utmp_record     *rec, copy;
+    const short     *types;
+    const int64_t   *secs;
+    struct timespec  start;
+    struct stat      sb;
+    long             count, i, n;
+    long long        sum;
+    int              fd;
+
+    if ( argc < 2 || argc > 3 ) {
+        fprintf(stderr, "usage: %s <wtmp-file> [columns-file]\n", argv[0]);
+        exit(1);
+    }
+    if ( argc == 3 )
+        columns_file = argv[2];
+    else {
+        if ( (fd = mkstemp( tmp )) == -1 )
+            die( "Cannot create ", tmp );
+        close( fd );
+        columns_file = tmp;
+        clock_gettime( CLOCK_MONOTONIC, &start );
+        if ( utmp_columns_write( argv[1], columns_file ) == -1 )
+            die( "Cannot convert ", argv[1] );
+        printf("converted in %.3f seconds\n\n", elapsed( &start ));
+    }
+
+    printf("%-10s %14s %10s %14s %20s\n", "scan", "file bytes", "records",
+           "records/sec", "checksum");
+
+    // the whole records, through the buffered reader
+    if ( open_utmp( argv[1] ) == -1 )
+        die( "Cannot open ", argv[1] );
+    if ( stat( argv[1], &sb ) == -1 )
+        die( "Cannot stat ", argv[1] );
+    count = 0;
+    sum   = 0;
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    while ( (rec = next_utmp()) != NULL_UTMP_RECORD_PTR ) {
+        sum += rec->ut_type + rec->ut_tv.tv_sec;
+        count++;
+    }
+    report( "next_utmp", sb.st_size, count, elapsed( &start ), sum );
+    close_utmp();
+
+    if ( (cols = utmp_columns_open( columns_file )) == NULL )
+        die( "Cannot open ", columns_file );
+    if ( stat( columns_file, &sb ) == -1 )
+        die( "Cannot stat ", columns_file );
+    n = utmp_columns_count( cols );
+
+    // just the two columns
+    sum = 0;
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    types = utmp_columns_get( cols, UTMP_COL_TYPE );
+    secs  = utmp_columns_get( cols, UTMP_COL_SEC );
+    for ( i = 0; i < n; i++ )
+        sum += types[i] + secs[i];
+    report( "columns", sb.st_size, n, elapsed( &start ), sum );
+
+    // whole records rebuilt from the columns
+    sum = 0;
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    for ( i = 0; i < n; i++ ) {
+        if ( utmp_columns_record( cols, i, &copy ) == -1 )
+            die( "Bad record in ", columns_file );
+        sum += copy.ut_type + copy.ut_tv.tv_sec;
+    }
+    report( "records", sb.st_size, n, elapsed( &start ), sum );
+
+    utmp_columns_close( cols );
+    if ( columns_file == tmp )
+        unlink( tmp );
+    return 0;
+}
+
+
+double elapsed( struct timespec *start )
+{
+    struct timespec  now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+
+void report( char *name, long long bytes, long count, double secs,
+             long long sum )
+{
+    printf("%-10s %14lld %10ld %14.0f %20lld\n", name, bytes, count,
+           secs > 0 ? count / secs : 0.0, sum);
+}
@@ -0,0 +1,139 @@
+/******************************************************************************
+  Title          : gen_wtmp.c
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Writes a synthetic wtmp file
+  Purpose        : To make wtmp files of any size, the same every time for the
+                   same options, for testing and timing the programs in this
+                   chapter without real login records
+  Usage          : gen_wtmp [options] count file
+                   where count is a number of records, optionally followed
+                   by k or m, and file is "-" for the standard output.
+                   Options, with their defaults:
+                     -s seed       random seed (1)
+                     -u users      number of distinct users (500)
+                     -l lines      number of terminal lines (64)
+                     -h hosts      number of distinct remote hosts (100)
+                     -d exp|uniform|pareto
+                                   distribution of session lengths (exp)
+                     -m seconds    mean session length (1800)
+                     -g seconds    mean time between logins (60)
+                     -b records    about how often to reboot; 0 never (50000)
+                     -c percent    how many of the reboots are crashes (10)
+                     -j records    about how often the clock is set; 0 never (0)
+                     -J seconds    most the clock is moved each time (3600)
+                     -t time       time of the first boot, in seconds since
+                                   the Epoch (1577836800, Jan 1 2020)
+  Build with     : gcc -o gen_wtmp gen_wtmp.c utmp_gen.c -I../include \
+                   -L../lib -lutils -lm
+
+******************************************************************************
+ * Copyright (C) 2020 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "utmp_gen.h"
+#include "utils.h"
+
+char usage[] = "usage: gen_wtmp [-s seed] [-u users] [-l lines] [-h hosts]\n"
+               "         [-d exp|uniform|pareto] [-m mean-session] "
+               "[-g mean-gap]\n"
+               "         [-b boot-every] [-c crash-percent] [-j jump-every] "
+               "[-J max-jump]\n"
+               "         [-t start] count file\n";
+
+/*****************************************************************************
+  number( string, option )
+  returns the non-negative number in a string such as "10k" or "2m"; exits
+  with a message naming the option if it is not one
+ *****************************************************************************/
+long number( char *, char * );
+
+
+/*****************************************************************************
+                               Main Program
+*****************************************************************************/
+int main(int argc, char* argv[])
+{
+    utmp_gen_config  cfg;
+    int              ch;
+
+    utmp_gen_defaults( &cfg );
+    while ( (ch = getopt( argc, argv, "s:u:l:h:d:m:g:b:c:j:J:t:" )) != -1 ) {
+        switch ( ch ) {
+        case 's': cfg.seed          = number( optarg, "-s" ); break;
+        case 'u': cfg.users         = number( optarg, "-u" ); break;
+        case 'l': cfg.lines         = number( optarg, "-l" ); break;
+        case 'h': cfg.hosts         = number( optarg, "-h" ); break;
+        case 'm': cfg.mean_session  = number( optarg, "-m" ); break;
+        case 'g': cfg.mean_gap      = number( optarg, "-g" ); break;
+        case 'b': cfg.boot_every    = number( optarg, "-b" ); break;
+        case 'c': cfg.crash_percent = number( optarg, "-c" ); break;
+        case 'j': cfg.jump_every    = number( optarg, "-j" ); break;
+        case 'J': cfg.max_jump      = number( optarg, "-J" ); break;
+        case 't': cfg.start         = number( optarg, "-t" ); break;
+        case 'd':
+            if ( strcmp( optarg, "exp" ) == 0 )
+                cfg.distribution = UTMP_GEN_EXP;
+            else if ( strcmp( optarg, "uniform" ) == 0 )
+                cfg.distribution = UTMP_GEN_UNIFORM;
+            else if ( strcmp( optarg, "pareto" ) == 0 )
+                cfg.distribution = UTMP_GEN_PARETO;
+            else {
+                fprintf(stderr, "unknown distribution: %s\n", optarg);
+                exit(1);
+            }
+            break;
+        default:
+            fprintf(stderr, "%s", usage);
+            exit(1);
+        }
+    }
+    if ( argc - optind != 2 ) {
+        fprintf(stderr, "%s", usage);
+        exit(1);
+    }
+    if ( utmp_gen_write( &cfg, argv[optind + 1],
+                         number( argv[optind], "count" ) ) == -1 )
+        die( "Cannot write ", argv[optind + 1] );
+    return 0;
+}
+
+
+long number( char *str, char *option )
+{
+    char  *end;
+    long   n = strtol( str, &end, 10 );
+
+    if ( *end == 'k' || *end == 'K' ) {
+        n *= 1000;
+        end++;
+    }
+    else if ( *end == 'm' || *end == 'M' ) {
+        n *= 1000000;
+        end++;
+    }
+    if ( end == str || *end != '\0' || n < 0 ) {
+        fprintf(stderr, "bad number for %s: %s\n", option, str);
+        exit(1);
+    }
+    return n;
+}
@@ -6,6 +6,7 @@
   Purpose        : To demonstrate opening a file in read/write mode and updating
                    a log file
   Usage          : logout_utmp <utmp-file> <terminal-line>
+                   logout_utmp -b <utmp-file> [<terminal-line> ...]
                    where
                         <utmp-file> is a utmp file that is  writable by the user
                    and
@@ -13,6 +14,10 @@
                         logout being simulated took place. If the lines in the
                         utmp file are of the form "/dev/pts/4" then the user
                         mustenter them in that form as well.
+                   With -b, every line given is logged out in one batch. If
+                   no lines are given, they are read from the standard
+                   input, one to a line. Each line that has no login on it
+                   is reported.
 
   Notes            Create a copy of the utmp file into the working directory
                    and make it writable by the user if it is not. Use a command
@@ -24,7 +29,22 @@
                    DO NOT NAME THIS PROGRAM logout -- IT IS SAFER TO NAME IT
                    DIFFERENTLY.
 
-  Build with     : gcc -o logout_utmp logout_utmp.c
+                   The batch mode is for closing many lines at once, as
+                   after a crash. Rather than a read() per record and an
+                   lseek() and write() per change, it locks the whole file
+                   with fcntl(), maps it, and changes every USER_PROCESS
+                   record on one of the lines to a DEAD_PROCESS record with
+                   the same logout time in a single pass over the mapping.
+                   The lines are kept in an intern table from the utilities
+                   library, and a record's line is one of them if
+                   intern_lookup() finds it there; the lookup never adds to
+                   the table, so the pass allocates nothing. Only the pages
+                   from the first changed record to the last are written
+                   back with msync(), and the lock is held until they have
+                   been.
+
+  Build with     : gcc -o logout_utmp logout_utmp.c -I../include \
+                   -L../lib -lutils
 
 ******************************************************************************
  * Copyright (C) 2020 - Stewart Weiss
@@ -53,6 +73,25 @@
 #include <string.h>
 #include <fcntl.h>
 #include <utmp.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "utils.h"
+
+
+/*****************************************************************************
+  logout_batch( utmp_file, lines, nlines )
+  logs out every one of the nlines lines in one pass over the mapped file,
+  or the lines read from the standard input if nlines is 0
+ *****************************************************************************/
+void logout_batch(char *, char **, int);
+
+/*****************************************************************************
+  add_line( table, line )
+  adds a line to be logged out to the intern table, after checking that it
+  fits in ut_line
+ *****************************************************************************/
+void add_line(intern_table *, char *);
 
 
 /*****************************************************************************
@@ -66,8 +105,14 @@ int main(int argc, char* argv[])
     struct timeval tv;
 
     // check usage
+    if ( argc >= 3 && strcmp(argv[1], "-b") == 0 ) {
+        logout_batch(argv[2], &argv[3], argc - 3);
+        return 0;
+    }
     if ( argc < 3 ){
-        fprintf( stderr, "usage: %s <utmp-file> <line>\n", argv[0]);
+        fprintf( stderr, "usage: %s <utmp-file> <line>\n"
+                         "       %s -b <utmp-file> [<line> ...]\n",
+                 argv[0], argv[0]);
         exit(1);
     }
 
@@ -118,3 +163,133 @@ int main(int argc, char* argv[])
     return 0;
 }
 
+
+
+void logout_batch( char *utmp_file, char **line_args, int nlines )
+{
+    intern_table  *lines;           // the lines to log out, with ids 0..
+    int            nwanted;         // the number of distinct lines
+    char          *found;           // found[id] if line id had a login
+    struct utmp   *recs;            // the mapped file
+    size_t         nrecs, i;
+    long           first = -1, last = -1;   // the changed records
+    size_t         pagesize, start, end;
+    char          *input = NULL;
+    size_t         room = 0;
+    ssize_t        len;
+    int            fd, id;
+    struct flock   lock;
+    struct stat    sb;
+    struct timeval tv;
+
+    if ( (lines = intern_new()) == NULL ) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    if ( nlines > 0 )
+        for ( i = 0; i < (size_t) nlines; i++ )
+            add_line(lines, line_args[i]);
+    else
+        while ( (len = getline(&input, &room, stdin)) != -1 ) {
+            if ( len > 0 && input[len - 1] == '\n' )
+                input[--len] = '\0';
+            if ( len > 0 )
+                add_line(lines, input);
+        }
+    free(input);
+    if ( (nwanted = intern_count(lines)) == 0 ) {
+        intern_free(lines);
+        return;
+    }
+    if ( (found = calloc(nwanted, 1)) == NULL ) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+
+    // open the file and lock all of it for the whole batch
+    if ( (fd = open(utmp_file, O_RDWR)) == -1 ) {
+        fprintf(stderr, "Cannot open %s\n", utmp_file);
+        exit(1);
+    }
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type   = F_WRLCK;
+    lock.l_whence = SEEK_SET;         // l_start and l_len 0: the whole file
+    if ( fcntl(fd, F_SETLKW, &lock) == -1 ) {
+        fprintf(stderr, "Cannot lock %s\n", utmp_file);
+        exit(1);
+    }
+    if ( fstat(fd, &sb) == -1 ) {
+        fprintf(stderr, "Cannot stat %s\n", utmp_file);
+        exit(1);
+    }
+
+    if ( (nrecs = sb.st_size / sizeof(struct utmp)) > 0 ) {
+        recs = mmap(NULL, nrecs * sizeof(struct utmp), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+        if ( recs == MAP_FAILED ) {
+            fprintf(stderr, "Cannot map %s\n", utmp_file);
+            exit(1);
+        }
+        if ( gettimeofday(&tv, NULL) != 0 ) {
+            fprintf( stderr, "error getting time of day\n");
+            exit(1);
+        }
+
+        for ( i = 0; i < nrecs; i++ ) {
+            if ( recs[i].ut_type != USER_PROCESS )
+                continue;
+            // a lookup, not intern_field(), so nothing is allocated while
+            // the file is locked and partly changed
+            id = intern_lookup(lines, recs[i].ut_line, sizeof(recs[i].ut_line));
+            if ( id == -1 )
+                continue;           // not one of the lines to log out
+            // change type, clear user and host members and set time
+            recs[i].ut_type = DEAD_PROCESS;
+            memset(recs[i].ut_user, 0, sizeof(recs[i].ut_user));
+            memset(recs[i].ut_host, 0, sizeof(recs[i].ut_host));
+            recs[i].ut_tv.tv_sec  = tv.tv_sec;
+            recs[i].ut_tv.tv_usec = tv.tv_usec;
+            found[id] = 1;
+            if ( first == -1 )
+                first = i;
+            last = i;
+        }
+
+        // write back only the pages that hold changed records
+        if ( first != -1 ) {
+            pagesize = sysconf(_SC_PAGESIZE);
+            start    = first * sizeof(struct utmp) / pagesize * pagesize;
+            end      = (last + 1) * sizeof(struct utmp);
+            if ( msync((char *) recs + start, end - start, MS_SYNC) == -1 ) {
+                fprintf( stderr, "failed write in utmp file\n");
+                exit(1);
+            }
+        }
+        munmap(recs, nrecs * sizeof(struct utmp));
+    }
+
+    lock.l_type = F_UNLCK;
+    fcntl(fd, F_SETLK, &lock);
+    close(fd);
+
+    for ( id = 0; id < nwanted; id++ )
+        if ( ! found[id] )
+            fprintf(stderr, "%s: no login on this line\n",
+                    intern_name(lines, id));
+    free(found);
+    intern_free(lines);
+}
+
+
+void add_line( intern_table *lines, char *line )
+{
+    // If the line is longer than a ut_line permits do not continue
+    if ( strlen(line) >= UT_LINESIZE ) {
+        fprintf(stderr, "Improper argument:%s\n", line);
+        exit(1);
+    }
+    if ( intern_field(lines, line, UT_LINESIZE) == -1 ) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+}
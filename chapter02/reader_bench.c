@@ -0,0 +1,565 @@
+/******************************************************************************
+  Title          : reader_bench.c
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Compares the ways the programs in this chapter read a
+                   utmp file, on synthetic files of several sizes
+  Purpose        : To show what each way of reading costs per record, in
+                   time, in system calls, and in memory
+  Usage          : reader_bench [-k] [-c] [size ...]
+                   where each size is a number of records, optionally
+                   followed by k or m (default 10k 1m). A file of each size
+                   is written in the temporary directory by utmp_gen.c,
+                   with its default settings, read with every strategy, and
+                   removed; -k keeps the files. -c drops the file from the
+                   page cache before each timed run, so that every strategy
+                   reads it from the disk.
+  Build with     : gcc -o reader_bench reader_bench.c utmp_utils.c \
+                   utmp_gen.c -I../include -L../lib -lutils -lm -lz -lpthread
+
+  Notes          : Each strategy runs in a child process whose standard
+                   output is /dev/null, and does nothing with a record but
+                   add up its type and time, so only the reading is timed.
+                   The peak RSS is the child's, from wait4(). The system
+                   calls are counted by a second child that is traced with
+                   ptrace(), which stops it at every system call; because
+                   that is slow, only the first SYSCALL_SAMPLE records are
+                   read, and only the calls made between the two getppid()
+                   calls that bracket the scan are counted. The threads the
+                   child starts, such as those of UTMP_PREFETCH readers, are
+                   traced as well.
+                   The fmt_ strategies also format every record as
+                   show_utmp does, so that there is work for reading ahead
+                   to overlap; with -c, fmt_prefetch against fmt_nomap shows
+                   what that gains. Dropping the cache with posix_fadvise()
+                   has no effect on a file system in memory such as tmpfs,
+                   so TMPDIR should then name a directory on a disk.
+                   A 10m file takes 3.8 GB of disk.
+
+******************************************************************************
+ * Copyright (C) 2020 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <utmp.h>
+#include <utmpx.h>
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/ptrace.h>
+#include "utmp_utils.h"
+#include "utmp_gen.h"
+#include "utils.h"
+
+#define SYSCALL_SAMPLE   100000      /* records read by the traced child */
+
+/* One way of reading a utmp file, and the programs that read that way */
+typedef struct {
+    char  *name;
+    char  *used_by;
+    long (*scan)( char *file, long limit, long *checksum );
+} strategy;
+
+/* What a timing child sends back to its parent */
+typedef struct {
+    long    records;
+    long    checksum;
+    double  secs;
+} run_result;
+
+static long scan_read( char *, long, long * );
+static long scan_getutent( char *, long, long * );
+static long scan_getutent_r( char *, long, long * );
+static long scan_getutxent( char *, long, long * );
+static long scan_next_utmp( char *, long, long * );
+static long scan_buffered( char *, long, long * );
+static long scan_batch( char *, long, long * );
+static long scan_next_utmpx( char *, long, long * );
+static long scan_prefetch( char *, long, long * );
+static long scan_fmt_nomap( char *, long, long * );
+static long scan_fmt_prefetch( char *, long, long * );
+
+static strategy strategies[] = {
+    { "read",         "who1 who2",            scan_read },
+    { "getutent",     "who3",                 scan_getutent },
+    { "getutent_r",   "who4",                 scan_getutent_r },
+    { "getutxent",    "-",                    scan_getutxent },
+    { "next_utmp",    "who5 show_utmp",       scan_next_utmp },
+    { "buffered",     "utmp_reader NOMAP",    scan_buffered },
+    { "batch",        "next_batch",           scan_batch },
+    { "next_utmpx",   "who_p",                scan_next_utmpx },
+    { "prefetch",     "utmp_reader PREFETCH", scan_prefetch },
+    { "fmt_nomap",    "NOMAP + put_ fields",  scan_fmt_nomap },
+    { "fmt_prefetch", "PREFETCH + put_",      scan_fmt_prefetch },
+    { NULL,           NULL,                   NULL }
+};
+
+static char *default_sizes[] = { "10k", "1m", NULL };
+
+/*****************************************************************************
+  make_file( dir, count )
+  writes a synthetic utmp file of count records in dir
+  returns: the malloc'ed name of the file
+ *****************************************************************************/
+char *make_file( const char *, long );
+
+/*****************************************************************************
+  drop_cache( file )
+  writes the file's dirty pages to disk and then drops all of its pages
+  from the page cache, so that the next read of it goes to the disk
+ *****************************************************************************/
+void drop_cache( char * );
+
+/*****************************************************************************
+  time_run( s, file, rss )
+  runs strategy s over file in a child process
+  returns: what the child sent back, with *rss set to its peak RSS in KB
+ *****************************************************************************/
+run_result time_run( strategy *, char *, long * );
+
+/*****************************************************************************
+  count_syscalls( s, file, records )
+  runs strategy s over at most SYSCALL_SAMPLE records of file in a traced
+  child process
+  returns: the number of system calls the scan made, with *records set to
+           the number of records it read; -1 if it could not be traced
+ *****************************************************************************/
+long count_syscalls( strategy *, char *, long * );
+
+/*****************************************************************************
+  parse_count( string )
+  returns the number in a string such as "10k" or "1m"
+ *****************************************************************************/
+long parse_count( char * );
+
+
+/*****************************************************************************
+                               Main Program
+*****************************************************************************/
+int main(int argc, char* argv[])
+{
+    char        **sizes = default_sizes;
+    char         *dir, *file;
+    int           keep = 0, cold = 0, ch;
+    long          n, rss, calls, sampled;
+    strategy     *s;
+    run_result    r;
+
+    while ( (ch = getopt( argc, argv, "kc" )) != -1 ) {
+        switch ( ch ) {
+        case 'k':
+            keep = 1;
+            break;
+        case 'c':
+            cold = 1;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-k] [-c] [size ...]\n", argv[0]);
+            exit(1);
+        }
+    }
+    if ( argc > optind )
+        sizes = &argv[optind];
+    if ( (dir = getenv( "TMPDIR" )) == NULL )
+        dir = "/tmp";
+
+    for ( ; *sizes != NULL; sizes++ ) {
+        n    = parse_count( *sizes );
+        file = make_file( dir, n );
+        printf("%ld records in %s%s\n", n, file,
+               cold ? ", read from disk" : "");
+        printf("%-12s %-21s %10s %14s %12s %10s\n", "strategy", "used by",
+               "records", "records/sec", "syscalls/rec", "peak KB");
+        for ( s = strategies; s->name != NULL; s++ ) {
+            fflush( stdout );
+            if ( cold )
+                drop_cache( file );
+            r     = time_run( s, file, &rss );
+            calls = count_syscalls( s, file, &sampled );
+            printf("%-12s %-21s %10ld %14.0f ", s->name, s->used_by,
+                   r.records, r.secs > 0 ? r.records / r.secs : 0.0);
+            if ( calls < 0 )
+                printf("%12s ", "-");
+            else
+                printf("%12.4f ", sampled > 0 ? (double) calls / sampled
+                                              : (double) calls);
+            printf("%10ld\n", rss);
+        }
+        printf("\n");
+        if ( ! keep )
+            unlink( file );
+        free( file );
+    }
+    return 0;
+}
+
+
+char *make_file( const char *dir, long count )
+{
+    utmp_gen_config  cfg;
+    char            *name;
+    int              fd;
+
+    name = malloc( strlen( dir ) + sizeof("/reader_benchXXXXXX") );
+    if ( name == NULL )
+        die( "Out of memory", "" );
+    sprintf( name, "%s/reader_benchXXXXXX", dir );
+    if ( (fd = mkstemp( name )) == -1 )
+        die( "Cannot create ", name );
+    close( fd );
+
+    utmp_gen_defaults( &cfg );
+    if ( utmp_gen_write( &cfg, name, count ) == -1 )
+        die( "Cannot write ", name );
+    return name;
+}
+
+
+void drop_cache( char *file )
+{
+    int  fd;
+
+    if ( (fd = open( file, O_RDONLY )) == -1 )
+        die( "Cannot open ", file );
+    fdatasync( fd );
+    posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+    close( fd );
+}
+
+
+run_result time_run( strategy *s, char *file, long *rss )
+{
+    run_result       r;
+    struct timespec  start, stop;
+    struct rusage    usage;
+    int              fds[2], status, null_fd;
+    pid_t            pid;
+
+    if ( pipe( fds ) == -1 )
+        die( "Cannot create pipe", "" );
+    if ( (pid = fork()) == -1 )
+        die( "Cannot fork", "" );
+    if ( pid == 0 ) {
+        close( fds[0] );
+        if ( (null_fd = open( "/dev/null", O_WRONLY )) != -1 ) {
+            dup2( null_fd, 1 );
+            close( null_fd );
+        }
+        clock_gettime( CLOCK_MONOTONIC, &start );
+        r.checksum = 0;
+        r.records  = s->scan( file, LONG_MAX, &r.checksum );
+        clock_gettime( CLOCK_MONOTONIC, &stop );
+        r.secs = (stop.tv_sec - start.tv_sec)
+                 + (stop.tv_nsec - start.tv_nsec) / 1e9;
+        write( fds[1], &r, sizeof(r) );
+        _exit( 0 );
+    }
+    close( fds[1] );
+    memset( &r, 0, sizeof(r) );
+    if ( read( fds[0], &r, sizeof(r) ) != sizeof(r) )
+        fprintf(stderr, "%s: no result from the child\n", s->name);
+    close( fds[0] );
+    if ( wait4( pid, &status, 0, &usage ) == -1 )
+        die( "Cannot wait for child", "" );
+    *rss = usage.ru_maxrss;
+    return r;
+}
+
+
+long count_syscalls( strategy *s, char *file, long *records )
+{
+    struct ptrace_syscall_info  info;
+    long                        calls = 0, checksum;
+    int                         status, markers = 0, fds[2], null_fd;
+    pid_t                       pid, tid;
+
+    *records = 0;
+    if ( pipe( fds ) == -1 )
+        die( "Cannot create pipe", "" );
+    if ( (pid = fork()) == -1 )
+        die( "Cannot fork", "" );
+    if ( pid == 0 ) {
+        close( fds[0] );
+        if ( (null_fd = open( "/dev/null", O_WRONLY )) != -1 ) {
+            dup2( null_fd, 1 );
+            close( null_fd );
+        }
+        if ( ptrace( PTRACE_TRACEME, 0, NULL, NULL ) == -1 )
+            _exit( 1 );
+        raise( SIGSTOP );
+        checksum = 0;
+        syscall( SYS_getppid );
+        *records = s->scan( file, SYSCALL_SAMPLE, &checksum );
+        syscall( SYS_getppid );
+        write( fds[1], records, sizeof(*records) );
+        _exit( 0 );
+    }
+    close( fds[1] );
+
+    if ( waitpid( pid, &status, 0 ) == -1 || ! WIFSTOPPED(status)
+         || ptrace( PTRACE_SETOPTIONS, pid, NULL, PTRACE_O_TRACESYSGOOD
+                    | PTRACE_O_EXITKILL | PTRACE_O_TRACECLONE ) == -1 ) {
+        kill( pid, SIGKILL );
+        waitpid( pid, &status, 0 );
+        close( fds[0] );
+        return -1;
+    }
+    // count the system call entries of every thread between the two
+    // getppid() calls of the first; the child's threads are traced from
+    // the moment they are created, and each stop is resumed as it comes
+    tid = pid;
+    while ( ptrace( PTRACE_SYSCALL, tid, NULL, NULL ) != -1 || tid != pid ) {
+        while ( (tid = waitpid( -1, &status, __WALL )) != -1
+                && ! WIFSTOPPED(status) && tid != pid )
+            ;           // a thread of the child has ended
+        if ( tid == -1 || ! WIFSTOPPED(status) )
+            break;
+        if ( WSTOPSIG(status) != ( SIGTRAP | 0x80 ) )
+            continue;
+        if ( ptrace( PTRACE_GET_SYSCALL_INFO, tid, sizeof(info), &info ) == -1
+             || info.op != PTRACE_SYSCALL_INFO_ENTRY )
+            continue;
+        if ( tid == pid && info.entry.nr == SYS_getppid )
+            markers++;
+        else if ( markers == 1 )
+            calls++;
+    }
+    if ( read( fds[0], records, sizeof(*records) ) != sizeof(*records) )
+        calls = -1;
+    close( fds[0] );
+    return markers == 2 ? calls : -1;
+}
+
+
+long parse_count( char *str )
+{
+    char  *end;
+    long   count = strtol( str, &end, 10 );
+
+    if ( *end == 'k' || *end == 'K' )
+        count *= 1000;
+    else if ( *end == 'm' || *end == 'M' )
+        count *= 1000000;
+    if ( count <= 0 ) {
+        fprintf(stderr, "bad record count: %s\n", str);
+        exit(1);
+    }
+    return count;
+}
+
+
+/*****************************************************************************
+  The strategies. Each reads at most limit records of file, adding the type
+  and time of each one to *checksum, and returns how many it read.
+ *****************************************************************************/
+
+// one read() per record
+static long scan_read( char *file, long limit, long *checksum )
+{
+    struct utmp  rec;
+    long         n = 0;
+    int          fd;
+
+    if ( (fd = open( file, O_RDONLY )) == -1 )
+        die( "Cannot open ", file );
+    while ( n < limit && read( fd, &rec, sizeof(rec) ) == sizeof(rec) ) {
+        *checksum += rec.ut_type + rec.ut_tv.tv_sec;
+        n++;
+    }
+    close( fd );
+    return n;
+}
+
+static long scan_getutent( char *file, long limit, long *checksum )
+{
+    struct utmp  *rec;
+    long          n = 0;
+
+    utmpname( file );
+    setutent();
+    while ( n < limit && (rec = getutent()) != NULL ) {
+        *checksum += rec->ut_type + rec->ut_tv.tv_sec;
+        n++;
+    }
+    endutent();
+    return n;
+}
+
+static long scan_getutent_r( char *file, long limit, long *checksum )
+{
+    struct utmp  buf, *rec;
+    long         n = 0;
+
+    utmpname( file );
+    setutent();
+    while ( n < limit && getutent_r( &buf, &rec ) == 0 ) {
+        *checksum += rec->ut_type + rec->ut_tv.tv_sec;
+        n++;
+    }
+    endutent();
+    return n;
+}
+
+static long scan_getutxent( char *file, long limit, long *checksum )
+{
+    struct utmpx  *rec;
+    long           n = 0;
+
+    utmpname( file );
+    setutxent();
+    while ( n < limit && (rec = getutxent()) != NULL ) {
+        *checksum += rec->ut_type + rec->ut_tv.tv_sec;
+        n++;
+    }
+    endutxent();
+    return n;
+}
+
+static long scan_next_utmp( char *file, long limit, long *checksum )
+{
+    utmp_record  *rec;
+    long          n = 0;
+
+    if ( open_utmp( file ) == -1 )
+        die( "Cannot open ", file );
+    while ( n < limit && (rec = next_utmp()) != NULL_UTMP_RECORD_PTR ) {
+        *checksum += rec->ut_type + rec->ut_tv.tv_sec;
+        n++;
+    }
+    close_utmp();
+    return n;
+}
+
+static long scan_buffered( char *file, long limit, long *checksum )
+{
+    utmp_reader  *reader;
+    utmp_record  *rec;
+    long          n = 0;
+
+    if ( (reader = utmp_reader_open_flags( file, UTMP_NOMAP, 0 )) == NULL )
+        die( "Cannot open ", file );
+    while ( n < limit && (rec = utmp_reader_next( reader ))
+                         != NULL_UTMP_RECORD_PTR ) {
+        *checksum += rec->ut_type + rec->ut_tv.tv_sec;
+        n++;
+    }
+    utmp_reader_close( reader );
+    return n;
+}
+
+static long scan_batch( char *file, long limit, long *checksum )
+{
+    utmp_reader  *reader;
+    utmp_record  *first;
+    long          n = 0;
+    int           i, got;
+
+    if ( (reader = utmp_reader_open( file )) == NULL )
+        die( "Cannot open ", file );
+    while ( n < limit && (got = utmp_reader_next_batch( reader, &first,
+                                   limit - n < INT_MAX ? limit - n : INT_MAX ))
+                         > 0 ) {
+        for ( i = 0; i < got; i++ )
+            *checksum += first[i].ut_type + first[i].ut_tv.tv_sec;
+        n += got;
+    }
+    utmp_reader_close( reader );
+    return n;
+}
+
+static long scan_next_utmpx( char *file, long limit, long *checksum )
+{
+    utmp_reader   *reader;
+    struct utmpx  *rec;
+    long           n = 0;
+
+    if ( (reader = utmp_reader_open( file )) == NULL )
+        die( "Cannot open ", file );
+    while ( n < limit && (rec = utmp_reader_next_utmpx( reader )) != NULL ) {
+        *checksum += rec->ut_type + rec->ut_tv.tv_sec;
+        n++;
+    }
+    utmp_reader_close( reader );
+    return n;
+}
+
+// utmp_reader with a thread reading the next buffer ahead
+static long scan_prefetch( char *file, long limit, long *checksum )
+{
+    utmp_reader  *reader;
+    utmp_record  *rec;
+    long          n = 0;
+
+    if ( (reader = utmp_reader_open_flags( file, UTMP_PREFETCH, 0 )) == NULL )
+        die( "Cannot open ", file );
+    while ( n < limit && (rec = utmp_reader_next( reader ))
+                         != NULL_UTMP_RECORD_PTR ) {
+        *checksum += rec->ut_type + rec->ut_tv.tv_sec;
+        n++;
+    }
+    utmp_reader_close( reader );
+    return n;
+}
+
+// reads with the given flags and formats each record as show_utmp does
+static long scan_format( char *file, int flags, long limit, long *checksum )
+{
+    utmp_reader  *reader;
+    utmp_record  *rec;
+    long          n = 0;
+
+    if ( (reader = utmp_reader_open_flags( file, flags, 0 )) == NULL )
+        die( "Cannot open ", file );
+    while ( n < limit && (rec = utmp_reader_next( reader ))
+                         != NULL_UTMP_RECORD_PTR ) {
+        put_field( rec->ut_user, sizeof(rec->ut_user), 8 );
+        put_char( ' ' );
+        put_field( rec->ut_line, sizeof(rec->ut_line), 8 );
+        put_char( ' ' );
+        put_time( rec->ut_tv.tv_sec );
+        put_char( ' ' );
+        put_long( rec->ut_exit.e_exit, -3 );
+        put_char( ' ' );
+        put_field( rec->ut_host, sizeof(rec->ut_host), 0 );
+        put_char( '\n' );
+        *checksum += rec->ut_type + rec->ut_tv.tv_sec;
+        n++;
+    }
+    put_flush();
+    utmp_reader_close( reader );
+    return n;
+}
+
+static long scan_fmt_nomap( char *file, long limit, long *checksum )
+{
+    return scan_format( file, UTMP_NOMAP, limit, checksum );
+}
+
+static long scan_fmt_prefetch( char *file, long limit, long *checksum )
+{
+    return scan_format( file, UTMP_PREFETCH, limit, checksum );
+}
@@ -0,0 +1,125 @@
+/******************************************************************************
+  Title          : sessions.c
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Lists the login sessions recorded in a wtmp file with
+                   their start and end times and durations
+  Purpose        : To demonstrate pairing each login record with the record
+                   that ends it in a single pass over the file
+  Usage          : sessions [wtmp-file]
+                   where wtmp-file defaults to the system wtmp file
+  Build with     : gcc -o sessions sessions.c utmp_sessions.c utmp_utils.c \
+                   -I../include -L../lib -lutils -lz -lpthread
+
+  Notes          : Sessions are printed in the order in which they end, one
+                   per line, much as last(1) prints them but oldest first.
+                   The reader is told to return only the record types that
+                   open or close sessions; utmp_sessions.c does the pairing.
+                   A session that ended because the system was rebooted or
+                   shut down, or because another login took over its line,
+                   is marked as such, and one still open at the end of the
+                   file is shown as "still logged in".
+
+******************************************************************************
+ * Copyright (C) 2020 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <utmp.h>
+#include "utmp_utils.h"
+#include "utmp_sessions.h"
+#include "utils.h"
+
+#define BATCH_SIZE  1024    /* most records to take from the reader at once */
+
+/*****************************************************************************
+  show_session( session, arg )
+  the pairer's callback: prints one session in human readable form
+ *****************************************************************************/
+void show_session( const utmp_session *, void * );
+
+
+/*****************************************************************************
+                               Main Program
+*****************************************************************************/
+int main(int argc, char* argv[])
+{
+    char            *file = WTMP_FILE;
+    utmp_reader     *reader;
+    utmp_record     *rec, *end;
+    session_pairer  *pairer;
+    int              count;
+
+    if ( argc > 2 ) {
+        fprintf(stderr, "usage: %s [wtmp-file]\n", argv[0]);
+        exit(1);
+    }
+    if ( argc == 2 )
+        file = argv[1];
+
+    if ( (reader = utmp_reader_open( file )) == NULL )
+        die( "Cannot open ", file );
+    utmp_reader_set_types( reader, UTMP_TYPE_MASK( USER_PROCESS )
+                                 | UTMP_TYPE_MASK( DEAD_PROCESS )
+                                 | UTMP_TYPE_MASK( BOOT_TIME )
+                                 | UTMP_TYPE_MASK( RUN_LVL ) );
+    if ( (pairer = session_pairer_new( show_session, NULL )) == NULL )
+        die( "Out of memory", "" );
+
+    while ( (count = utmp_reader_next_batch( reader, &rec, BATCH_SIZE )) > 0 )
+        for ( end = rec + count; rec < end; rec++ )
+            if ( session_pairer_add( pairer, rec ) == -1 )
+                die( "Out of memory", "" );
+
+    session_pairer_finish( pairer );
+    utmp_reader_close( reader );
+    return 0;
+}
+
+
+void show_session( const utmp_session *s, void *arg )
+{
+    char        start[32], stop[32];
+    struct tm   tm;
+    const char *how = NULL;
+
+    localtime_r( &s->start, &tm );
+    strftime( start, sizeof(start), "%Y-%m-%d %H:%M", &tm );
+    localtime_r( &s->end, &tm );
+    strftime( stop, sizeof(stop), "%H:%M", &tm );
+
+    switch ( s->how ) {
+    case SESSION_GONE:   how = "gone";            break;
+    case SESSION_CRASH:  how = "crash";           break;
+    case SESSION_DOWN:   how = "down";            break;
+    case SESSION_OPEN:   how = "still logged in"; break;
+    }
+
+    printf("%-8.8s %-12.12s %-16.16s %s ", s->user, s->line, s->host, start);
+    if ( s->how == SESSION_OPEN )
+        printf("  %s\n", how);
+    else if ( s->duration >= 86400 )
+        printf("- %-5s (%ld+%02ld:%02ld)\n", how ? how : stop,
+               s->duration / 86400, (s->duration / 3600) % 24,
+               (s->duration / 60) % 60);
+    else
+        printf("- %-5s (%02ld:%02ld)\n", how ? how : stop,
+               s->duration / 3600, (s->duration / 60) % 60);
+}
@@ -4,11 +4,62 @@
   Created on     : February, 2006
   Description    : Demonstrates how to process utmp structures
   Purpose        : 
-  Usage          : show_utmp [wtmp]
+  Usage          : show_utmp [-n N] [--since TIME] [--until TIME]
+                             [--user NAME] [--line LINE] [--host HOST]
+                             [--type TYPE,...] [--or ...]
+                             [--follow] [--checkpoint FILE] [wtmp | file]
                    if wtmp argument supplied, it shows the contents of
-                   wtmp file, otherwise utmp file
-  Build with     : gcc -o show_utmp show_utmp.c -DSHOWHOST -I../include \
-                   -L../lib -lutils  
+                   wtmp file; if another argument is supplied, it shows
+                   the contents of that file, which may be gzipped;
+                   otherwise it shows those of the utmp file
+                   -n N shows only the last N records of the file
+                   --since and --until show only records with times in that
+                   range; TIME is "YYYY-MM-DD", "YYYY-MM-DD HH:MM[:SS]" in
+                   local time, or "@" followed by seconds since the Epoch
+                   --user, --line and --host show only records whose field
+                   is the given string, or begins with it if it ends in *;
+                   --type shows only records of the listed types, such as
+                   USER_PROCESS,DEAD_PROCESS. A record must pass all of these
+                   tests, unless they are separated by --or, in which case
+                   it must pass all of those on one side or the other.
+                   --follow keeps running after the last record and shows
+                   records as they are appended to the file
+                   --checkpoint FILE resumes after the last record shown by
+                   a previous run that used the same FILE, and saves the new
+                   position in FILE
+  Build with     : gcc -o show_utmp show_utmp.c utmp_utils.c utmp_index.c \
+                   utmp_filter.c -DSHOWHOST -I../include -L../lib -lutils -lz -lpthread
+  Notes          : Records are read with the utmp_reader functions in
+                   utmp_utils.c rather than one read() call per record, and
+                   written with the put_ functions of the utilities library
+                   rather than several printf() calls per record.
+                   With -n, the reader is opened at the end of the file and
+                   backs up N records, so only the tail of a large wtmp file
+                   is ever read. Records are taken from the reader a block at
+                   a time with utmp_reader_next_batch().
+                   With --since or --until, the sparse time index kept in
+                   the file's ".idx" companion (see utmp_index.h) is brought
+                   up to date and used to skip the blocks of records that
+                   cannot be in the range. If the index cannot be written,
+                   the whole file is scanned instead.
+                   The record tests are compiled once into a utmp_filter
+                   (see utmp_filter.h), which is applied to the raw records
+                   before any of them is formatted; the reader itself skips
+                   the records whose types cannot match.
+                   With --follow, the program sleeps in read() on an
+                   inotify descriptor and wakes only when the file is
+                   written to, renamed or removed; it then reads just the
+                   new records. Without a checkpoint it starts at the end of
+                   the file (or N records before it, with -n). With a
+                   checkpoint file that does not exist yet it starts at the
+                   beginning. The checkpoint holds the byte offset of the
+                   next record and the file's inode number, so that a run
+                   after the file has been rotated starts over, and it is
+                   replaced by rename() so that it is never half written.
+                   A gzipped file, such as wtmp.1.gz, is decompressed by the
+                   reader as it is read. It can only be read forward, so -n
+                   cannot be used with it, and --since and --until scan it
+                   all instead of using an index.
 
 ******************************************************************************/
 
@@ -18,8 +69,18 @@
 #include <utmp.h>
 #include <fcntl.h>
 #include <string.h>
+#include <limits.h>
+#include <getopt.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include "utmp_utils.h"
+#include "utmp_index.h"
+#include "utmp_filter.h"
 #include "utils.h"
 
+#define BATCH_SIZE  1024    /* most records to take from the reader at once */
 
 /*****************************************************************************
   show info( struct utmp* )
@@ -35,30 +96,166 @@ void show_info(struct utmp *);
 void show_type(int );
 
 
+/*****************************************************************************
+  parse time( char* )
+  returns the time_t value of a --since or --until argument, exiting with a
+  message if it is not in one of the accepted forms
+ *****************************************************************************/
+time_t parse_time(char *);
+
+
+/*****************************************************************************
+  show records( utmp_reader* )
+  displays every remaining record of the reader that passes the filter
+ *****************************************************************************/
+void show_records(utmp_reader *);
+
+
+/*****************************************************************************
+  load checkpoint( char*, utmp_reader* )  save checkpoint( char*, utmp_reader* )
+  load moves the reader to the position saved in the checkpoint file, if the
+  file exists and is for the same utmp file; it returns 0 if it did, -1 if
+  not. save records the reader's position in the checkpoint file.
+ *****************************************************************************/
+int  load_checkpoint(char *, utmp_reader *);
+void save_checkpoint(char *, utmp_reader *);
+
+
+/*****************************************************************************
+  follow( char*, utmp_reader*, char* )
+  shows records as they are appended to the file; it does not return
+ *****************************************************************************/
+void follow(char *, utmp_reader *, char *);
+
+
+static time_t   since   = 0;          /* range of times to show   */
+static time_t   until   = LONG_MAX;
+static int      by_time = 0;          /* nonzero if range given   */
+static utmp_filter *filter;           /* the records to show      */
+
+static struct option long_options[] = {
+    { "since",      required_argument, NULL, 's' },
+    { "until",      required_argument, NULL, 'u' },
+    { "user",       required_argument, NULL, 'U' },
+    { "line",       required_argument, NULL, 'L' },
+    { "host",       required_argument, NULL, 'H' },
+    { "type",       required_argument, NULL, 'T' },
+    { "or",         no_argument,       NULL, 'o' },
+    { "follow",     no_argument,       NULL, 'f' },
+    { "checkpoint", required_argument, NULL, 'c' },
+    { NULL,         0,                 NULL,  0  }
+};
+
+
 /*****************************************************************************
                                Main Program
 *****************************************************************************/
 int main(int argc, char* argv[])
 {
-    struct utmp     utbuf;          /* read info into here */
-    int             utmpfd;         /* read from this descriptor */
- 
-    if ( (argc > 1) && (strcmp(argv[1],"wtmp") == 0) ) {
-        if ( (utmpfd = open(WTMP_FILE, O_RDONLY)) == -1 ){
-            perror(WTMP_FILE);
+    utmp_reader    *reader;         /* reads from this file     */
+    char           *utmp_file = UTMP_FILE;
+    long            last_n    = -1; /* number of records for -n */
+    int             flags     = 0;
+    int             ch;
+    int             following = 0;  /* nonzero for --follow     */
+    char           *checkpoint = NULL;
+    utmp_index     *index;
+    long            first, end;
+
+    if ( (filter = utmp_filter_new()) == NULL )
+        die("Out of memory", "");
+    while ( (ch = getopt_long(argc, argv, "n:f", long_options, NULL)) != -1 ) {
+        switch ( ch ) {
+        case 'n':
+            last_n = atol(optarg);
+            flags  = UTMP_FROM_END;
+            break;
+        case 's':
+            since   = parse_time(optarg);
+            by_time = 1;
+            break;
+        case 'u':
+            until   = parse_time(optarg);
+            by_time = 1;
+            break;
+        case 'U':
+        case 'L':
+        case 'H':
+        case 'T':
+            if ( utmp_filter_add(filter, ch == 'U' ? UTMP_FILTER_USER :
+                                         ch == 'L' ? UTMP_FILTER_LINE :
+                                         ch == 'H' ? UTMP_FILTER_HOST :
+                                                     UTMP_FILTER_TYPE,
+                                 optarg) == -1 )
+                die("Bad filter value ", optarg);
+            break;
+        case 'o':
+            if ( utmp_filter_or(filter) == -1 )
+                die("Out of memory", "");
+            break;
+        case 'f':
+            following = 1;
+            break;
+        case 'c':
+            checkpoint = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n N] [--since TIME] [--until TIME]"
+                            " [--user NAME] [--line LINE] [--host HOST]"
+                            " [--type TYPE,...] [--or ...]"
+                            " [--follow] [--checkpoint FILE] [wtmp | file]\n",
+                    argv[0]);
             exit(1);
         }
     }
-        
-    else 
-        if ( (utmpfd = open(UTMP_FILE, O_RDONLY)) == -1 ){
-            perror(UTMP_FILE);
-            exit(1);
-        }
+    if ( by_time )
+        utmp_filter_range(filter, since, until);
+
+    if ( (argc > optind) && (strcmp(argv[optind],"wtmp") == 0) )
+        utmp_file = WTMP_FILE;
+    else if ( argc > optind )
+        utmp_file = argv[optind];
+
+    /* a mapping cannot grow with the file, so read it through a buffer */
+    if ( following || checkpoint != NULL )
+        flags |= UTMP_NOMAP;
+
+    if ( (reader = utmp_reader_open_flags(utmp_file, flags, 0)) == NULL ){
+        perror(utmp_file);
+        exit(1);
+    }
+
+    /* resume where the last run with this checkpoint left off */
+    if ( checkpoint != NULL && load_checkpoint(checkpoint, reader) == 0 )
+        ;
+
+    /* back up over the last N records, then show them in order */
+    else if ( flags & UTMP_FROM_END )
+        while ( last_n-- > 0 && utmp_reader_prev(reader) != NULL_UTMP_RECORD_PTR )
+            ;
 
-    while( read(utmpfd, &utbuf, sizeof(utbuf)) == sizeof(utbuf) )
-        show_info( &utbuf );
-    close(utmpfd);
+    /* when following from scratch, only new records are shown */
+    else if ( following && checkpoint == NULL )
+        utmp_reader_seek(reader, utmp_reader_count(reader));
+
+    /* skip straight to the part of the file the time range can be in */
+    else if ( by_time && ! following
+              && (index = utmp_index_open(utmp_file, NULL, 0)) != NULL ) {
+        utmp_index_range(index, since, until, &first, &end);
+        utmp_index_close(index);
+        utmp_reader_seek(reader, first);
+        utmp_reader_set_limit(reader, end);
+    }
+
+    if ( following )
+        follow(utmp_file, reader, checkpoint);
+
+    show_records(reader);
+    put_flush();        /* before the checkpoint says the records were shown */
+    if ( checkpoint != NULL )
+        save_checkpoint(checkpoint, reader);
+    utmp_reader_close(reader);
+    utmp_filter_free(filter);
     return 0;
 }
 
@@ -66,27 +263,186 @@ int main(int argc, char* argv[])
 /*****************************************************************************
   show info()
   displays contents of the utmp struct in human readable form
-  The sizes used in the printf below are not guaranteed to work on all systems.
+  The field widths used below are not guaranteed to work on all systems.
   The ut_time member may be 32 or 64 bits.
   If the type of entry is not USER_PROCESS, it skips the record
  *****************************************************************************/
 void show_info( struct utmp *utbufp )
 {
     show_type(utbufp->ut_type);
-    printf("%-8.8s", utbufp->ut_name);      /* the logname  */
-    printf(" ");                            /* a space      */
-    printf("%-8.8s", utbufp->ut_line);      /* the tty      */
-    printf(" ");                            /* a space      */
-    show_time( utbufp->ut_time );           /* display time */
-    printf(" ");                           
-    printf("%-3d ", utbufp->ut_exit.e_exit);
-    printf("%-3d ", utbufp->ut_exit.e_termination);
+    put_field(utbufp->ut_name, sizeof(utbufp->ut_name), 8);  /* the logname */
+    put_char(' ');                          /* a space      */
+    put_field(utbufp->ut_line, sizeof(utbufp->ut_line), 8);  /* the tty     */
+    put_char(' ');                          /* a space      */
+    put_time( utbufp->ut_time );            /* display time */
+    put_char(' ');
+    put_long(utbufp->ut_exit.e_exit, -3);
+    put_char(' ');
+    put_long(utbufp->ut_exit.e_termination, -3);
+    put_char(' ');
 
 #ifdef SHOWHOST
-    if ( utbufp->ut_host[0] != '\0' )
-        printf(" (%s)", utbufp->ut_host);/* the host    */
+    if ( utbufp->ut_host[0] != '\0' ) {    /* the host     */
+        put_str(" (");
+        put_field(utbufp->ut_host, sizeof(utbufp->ut_host), 0);
+        put_char(')');
+    }
 #endif
-        printf("\n");                   
+    put_char('\n');
+}
+
+
+/*****************************************************************************
+  show records()
+  displays the records from the reader's position to the end of the file,
+  skipping any that the filter rejects. The type mask is set here rather
+  than when the reader is opened so that -n counts every record, and so
+  that it applies to the new reader after a rotation.
+ *****************************************************************************/
+void show_records( utmp_reader *reader )
+{
+    utmp_record    *utbufp;         /* points to current record */
+    utmp_record    *batch_end;      /* just past the current batch */
+    int             count;          /* records in the current batch */
+
+    utmp_reader_set_types(reader, utmp_filter_types(filter));
+    while( (count = utmp_reader_next_batch(reader, &utbufp, BATCH_SIZE)) > 0 )
+        for ( batch_end = utbufp + count; utbufp < batch_end; utbufp++ )
+            if ( utmp_filter_match(filter, utbufp) )
+                show_info( utbufp );
+}
+
+
+/*****************************************************************************
+  follow()
+  Shows the new records, saves the checkpoint, and then blocks until inotify
+  reports that the file has changed. If the file was renamed or removed, as
+  when it is rotated, the rest of it is shown and then the new file at the
+  same path is opened and followed from its beginning. If the file has
+  shrunk, it has been truncated and is also read again from the beginning.
+ *****************************************************************************/
+void follow( char *utmp_file, utmp_reader *reader, char *checkpoint )
+{
+    char            events[4096]
+                    __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    struct inotify_event *ev;
+    ssize_t         len;
+    int             ifd, wd, rotated;
+    long            pos;
+    struct stat     sb;
+
+    if ( (ifd = inotify_init()) == -1 )
+        die("inotify_init", "");
+    if ( (wd = inotify_add_watch(ifd, utmp_file,
+                                 IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF)) == -1 )
+        die("Cannot watch ", utmp_file);
+
+    for ( ;; ) {
+        show_records(reader);
+        put_flush();
+        if ( checkpoint != NULL )
+            save_checkpoint(checkpoint, reader);
+
+        if ( (len = read(ifd, events, sizeof(events))) == -1 ) {
+            if ( errno == EINTR )
+                continue;
+            die("read from inotify", "");
+        }
+        rotated = 0;
+        for ( ev = (struct inotify_event *) events;
+              (char *) ev < events + len;
+              ev = (struct inotify_event *) ((char *) ev + sizeof(*ev) + ev->len) )
+            if ( ev->wd == wd && (ev->mask & (IN_MOVE_SELF | IN_DELETE_SELF)) )
+                rotated = 1;
+
+        if ( rotated ) {
+            /* finish the old file, then wait for the new one to appear */
+            show_records(reader);
+            utmp_reader_close(reader);
+            inotify_rm_watch(ifd, wd);
+            while ( (reader = utmp_reader_open_flags(utmp_file, UTMP_NOMAP, 0))
+                        == NULL )
+                sleep(1);
+            if ( (wd = inotify_add_watch(ifd, utmp_file,
+                        IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF)) == -1 )
+                die("Cannot watch ", utmp_file);
+            continue;
+        }
+
+        /* a file shorter than what has been read was truncated */
+        pos = utmp_reader_tell(reader);
+        if ( fstat(utmp_reader_fd(reader), &sb) == 0
+               && sb.st_size < (off_t) (pos * sizeof(utmp_record)) )
+            utmp_reader_seek(reader, 0);
+    }
+}
+
+
+/*****************************************************************************
+  load checkpoint()
+  The checkpoint file holds one line: the byte offset of the next record to
+  show and the inode number of the utmp file. It is used only if the inode
+  is still that of the utmp file and the offset is not past its end.
+ *****************************************************************************/
+int load_checkpoint( char *checkpoint, utmp_reader *reader )
+{
+    FILE           *fp;
+    long long       offset;
+    unsigned long   ino;
+    struct stat     sb;
+    int             ok;
+
+    if ( (fp = fopen(checkpoint, "r")) == NULL )
+        return -1;
+    ok = fscanf(fp, "%lld %lu", &offset, &ino) == 2;
+    fclose(fp);
+
+    if ( ! ok || fstat(utmp_reader_fd(reader), &sb) == -1
+              || sb.st_ino != ino || offset > sb.st_size || offset < 0 )
+        return utmp_reader_seek(reader, 0);   /* start over, but do resume */
+    return utmp_reader_seek(reader, offset / sizeof(utmp_record));
+}
+
+
+/*****************************************************************************
+  save checkpoint()
+  writes the checkpoint to a temporary file and renames it over the old one
+ *****************************************************************************/
+void save_checkpoint( char *checkpoint, utmp_reader *reader )
+{
+    static long long  saved = -1;       /* last offset written */
+    long long         offset;
+    char              tmp[PATH_MAX];
+    FILE             *fp;
+    struct stat       sb;
+
+    offset = (long long) utmp_reader_tell(reader) * sizeof(utmp_record);
+    if ( offset == saved || fstat(utmp_reader_fd(reader), &sb) == -1 )
+        return;
+    snprintf(tmp, sizeof(tmp), "%s.tmp", checkpoint);
+    if ( (fp = fopen(tmp, "w")) == NULL )
+        die("Cannot write ", tmp);
+    fprintf(fp, "%lld %lu\n", offset, (unsigned long) sb.st_ino);
+    if ( fclose(fp) != 0 || rename(tmp, checkpoint) == -1 )
+        die("Cannot save checkpoint ", checkpoint);
+    saved = offset;
+}
+
+
+/*****************************************************************************
+  parse time()
+  accepts "@seconds", "YYYY-MM-DD HH:MM:SS", "YYYY-MM-DD HH:MM" and
+  "YYYY-MM-DD", the last three in local time
+ *****************************************************************************/
+time_t parse_time( char *arg )
+{
+    time_t       t;
+
+    if ( utmp_filter_parse_time(arg, &t) == -1 ) {
+        fprintf(stderr, "bad time: %s\n", arg);
+        exit(1);
+    }
+    return t;
 }
 
 
@@ -98,14 +454,14 @@ void show_type( int t)
 {
     switch (t)
     {
-    case RUN_LVL:      	printf("RUN_LVL       "); break;               
-    case BOOT_TIME:     printf("BOOT_TIME     "); break;             
-    case NEW_TIME:      printf("NEW_TIME      "); break;              
-    case OLD_TIME:      printf("OLD_TIME      "); break;              
-    case INIT_PROCESS:  printf("INIT_PROCESS  "); break;          
-    case LOGIN_PROCESS: printf("LOGIN_PROCESS "); break;         
-    case USER_PROCESS:  printf("USER_PROCESS  "); break;          
-    case DEAD_PROCESS:  printf("DEAD_PROCESS  "); break;          
-    case ACCOUNTING:    printf("ACCOUNTING    "); break;            
+    case RUN_LVL:      	put_str("RUN_LVL       "); break;
+    case BOOT_TIME:     put_str("BOOT_TIME     "); break;
+    case NEW_TIME:      put_str("NEW_TIME      "); break;
+    case OLD_TIME:      put_str("OLD_TIME      "); break;
+    case INIT_PROCESS:  put_str("INIT_PROCESS  "); break;
+    case LOGIN_PROCESS: put_str("LOGIN_PROCESS "); break;
+    case USER_PROCESS:  put_str("USER_PROCESS  "); break;
+    case DEAD_PROCESS:  put_str("DEAD_PROCESS  "); break;
+    case ACCOUNTING:    put_str("ACCOUNTING    "); break;
     }
 }
@@ -4,11 +4,35 @@
   Created on     : February, 2006
   Description    : Demonstrates how to process utmp structures
   Purpose        :
-  Usage          : show_utmp [wtmp]
-                   if wtmp argument supplied, it shows the contents of
-                   wtmp file, otherwise utmp file
-  Build with     : gcc -o show_utmp show_utmp.c -DSHOWHOST -I../include \
-                   -L../lib -lutils
+  Usage          : show_utmp2 [--since TIME] [--until TIME] [--user NAME]
+                              [--line LINE] [--host HOST] [--type TYPE,...]
+                              [--or ...] [--group-by KEY] [--count] [file]
+                   if a file argument is supplied, it shows the contents of
+                   that file, otherwise utmp file. The options select the
+                   records to show, as in show_utmp.
+                   --count prints the number of selected records instead
+                   of the records. --group-by prints that number for each
+                   user, host, line, hour of the day or day, as KEY is user,
+                   host, line, hour or day; the users, hosts and lines most
+                   often seen come first, and hours and days are in order.
+  Build with     : gcc -o show_utmp2 show_utmp2.c utmp_utils.c utmp_filter.c \
+                   -DSHOWHOST -I../include -L../lib -lutils -lz -lpthread
+  Notes          : The options are compiled into a utmp_filter once, and
+                   each record is tested with it as soon as it is read, so
+                   that no time is spent formatting records that are not
+                   shown. The records are read with the utmp_reader
+                   functions in utmp_utils.c, which map regular files,
+                   decompress gzipped ones and put records that arrive in
+                   pieces through a pipe back together; they are taken from
+                   the reader BATCH_SIZE at a time, and the reader skips the
+                   types that the filter never accepts.
+                   When grouping, users, hosts and lines are counted in a
+                   count table from ../utilities, which interns them and
+                   counts them in an array indexed by their ids; hours and
+                   days are counted in
+                   arrays indexed by the hour and by the day number. The
+                   local hour and day of a record are worked out only when
+                   it is not in the same hour as the one before it.
 
 ******************************************************************************
  * Copyright (C) 2020 - Stewart Weiss
@@ -32,12 +56,27 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h>
 #include <utmp.h>
-#include <fcntl.h>
 #include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <getopt.h>
+#include "utmp_utils.h"
+#include "utmp_filter.h"
 #include "utils.h"
 
+#define BATCH_SIZE  1024    /* most records to take from the reader at once */
+
+/* what to group by */
+#define GROUP_NONE   0
+#define GROUP_USER   1
+#define GROUP_HOST   2
+#define GROUP_LINE   3
+#define GROUP_HOUR   4
+#define GROUP_DAY    5
+
+static char *group_names[] = { "", "user", "host", "line", "hour", "day", NULL };
+
 
 /*****************************************************************************
   show info( struct utmp* )
@@ -53,57 +92,315 @@ void show_info(struct utmp *);
 void show_type(int );
 
 
+/*****************************************************************************
+  count record( struct utmp*, int )
+  adds the record to the count for its key, or to the total for GROUP_NONE
+ *****************************************************************************/
+void count_record(struct utmp *, int);
+
+
+/*****************************************************************************
+  print counts( int )
+  displays the counts made by count_record()
+ *****************************************************************************/
+void print_counts(int);
+
+
+static struct option long_options[] = {
+    { "since",      required_argument, NULL, 's' },
+    { "until",      required_argument, NULL, 'u' },
+    { "user",       required_argument, NULL, 'U' },
+    { "line",       required_argument, NULL, 'L' },
+    { "host",       required_argument, NULL, 'H' },
+    { "type",       required_argument, NULL, 'T' },
+    { "or",         no_argument,       NULL, 'o' },
+    { "group-by",   required_argument, NULL, 'g' },
+    { "count",      no_argument,       NULL, 'c' },
+    { NULL,         0,                 NULL,  0  }
+};
+
+/* counts of the users, hosts or lines */
+static count_table   keys;
+
+/* counts of the hours of the day, and of the days from first_day on */
+static long          hour_counts[24];
+static long         *day_counts;
+static long          first_day;
+static long          ndays;
+
+static long          total;
+
+
 /*****************************************************************************
                                Main Program
 *****************************************************************************/
 int main(int argc, char* argv[])
 {
-    struct utmp     utbuf;          /* read info into here */
-    int             utmpfd;         /* read from this descriptor */
+    char           *utmp_file = UTMP_FILE;
+    utmp_reader    *reader;         /* reads from utmp_file */
+    utmp_record    *utbufp;         /* points to current record */
+    utmp_record    *batch_end;      /* just past the current batch */
+    utmp_filter    *filter;         /* the records to show */
+    time_t          since = LONG_MIN, until = LONG_MAX;
+    int             ch, count;
+    int             counting = 0;   /* nonzero for --count or --group-by */
+    int             group_by = GROUP_NONE;
 
-    if ( argc > 1)  {
-        if ( (utmpfd = open(argv[1], O_RDONLY)) == -1 ){
+    if ( (filter = utmp_filter_new()) == NULL )
+        die("Out of memory", "");
+    while ( (ch = getopt_long(argc, argv, "", long_options, NULL)) != -1 ) {
+        switch ( ch ) {
+        case 's':
+        case 'u':
+            if ( utmp_filter_parse_time(optarg, ch == 's' ? &since : &until)
+                 == -1 ) {
+                fprintf(stderr, "bad time: %s\n", optarg);
+                exit(1);
+            }
+            utmp_filter_range(filter, since, until);
+            break;
+        case 'U':
+        case 'L':
+        case 'H':
+        case 'T':
+            if ( utmp_filter_add(filter, ch == 'U' ? UTMP_FILTER_USER :
+                                         ch == 'L' ? UTMP_FILTER_LINE :
+                                         ch == 'H' ? UTMP_FILTER_HOST :
+                                                     UTMP_FILTER_TYPE,
+                                 optarg) == -1 )
+                die("Bad filter value ", optarg);
+            break;
+        case 'o':
+            if ( utmp_filter_or(filter) == -1 )
+                die("Out of memory", "");
+            break;
+        case 'g':
+            for ( group_by = GROUP_USER; group_names[group_by] != NULL;
+                  group_by++ )
+                if ( strcmp(optarg, group_names[group_by]) == 0 )
+                    break;
+            if ( group_names[group_by] == NULL ) {
+                fprintf(stderr, "cannot group by %s\n", optarg);
+                exit(1);
+            }
+            counting = 1;
+            break;
+        case 'c':
+            counting = 1;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [--since TIME] [--until TIME]"
+                            " [--user NAME] [--line LINE] [--host HOST]"
+                            " [--type TYPE,...] [--or ...]"
+                            " [--group-by user|host|line|hour|day] [--count]"
+                            " [file]\n", argv[0]);
             exit(1);
         }
     }
+    if ( group_by >= GROUP_USER && group_by <= GROUP_LINE
+         && count_table_init(&keys) == -1 )
+        die("Out of memory", "");
 
-    else
-        if ( (utmpfd = open(UTMP_FILE, O_RDONLY)) == -1 ){
-            perror(UTMP_FILE);
-            exit(1);
-        }
+    if ( argc > optind )
+        utmp_file = argv[optind];
+    if ( (reader = utmp_reader_open(utmp_file)) == NULL ){
+        perror(utmp_file);
+        exit(1);
+    }
 
-    while( read(utmpfd, &utbuf, sizeof(utbuf)) == sizeof(utbuf) )
-        show_info( &utbuf );
-    close(utmpfd);
+    utmp_reader_set_types(reader, utmp_filter_types(filter));
+    while( (count = utmp_reader_next_batch(reader, &utbufp, BATCH_SIZE)) > 0 )
+        for ( batch_end = utbufp + count; utbufp < batch_end; utbufp++ )
+            if ( utmp_filter_match(filter, utbufp) ) {
+                if ( counting )
+                    count_record( utbufp, group_by );
+                else
+                    show_info( utbufp );
+            }
+    utmp_reader_close(reader);
+    utmp_filter_free(filter);
+    if ( counting )
+        print_counts(group_by);
     return 0;
 }
 
 
+/*****************************************************************************
+  count day( long )
+  adds one to the count of the given day, widening the array of days to
+  take it in if need be
+ *****************************************************************************/
+static void count_day( long day )
+{
+    long   lo, hi, *wider;
+
+    if ( ndays == 0 )
+        first_day = day;
+    if ( day < first_day || day >= first_day + ndays ) {
+        lo = day < first_day ? day : first_day;
+        hi = day >= first_day + ndays ? day + 1 : first_day + ndays;
+        // records are mostly in time order, so leave room for later days
+        hi += hi - lo;
+        if ( (wider = calloc(hi - lo, sizeof(long))) == NULL )
+            die("Out of memory", "");
+        if ( ndays > 0 )
+            memcpy(wider + (first_day - lo), day_counts, ndays * sizeof(long));
+        free(day_counts);
+        day_counts = wider;
+        first_day  = lo;
+        ndays      = hi - lo;
+    }
+    day_counts[day - first_day]++;
+}
+
+
+/*****************************************************************************
+  count record()
+  String keys are counted in the count table. The local hour and day of a
+  record are remembered along with the bounds of its hour, so that the next
+  record, which is usually in the same hour, needs no call to localtime_r().
+  The day is numbered from the Epoch by its local calendar date.
+ *****************************************************************************/
+void count_record( struct utmp *utbufp, int group_by )
+{
+    static time_t  hour_start = 1, hour_end = 0;     /* none yet */
+    static int     hour;
+    static long    day;
+    time_t         t = utbufp->ut_tv.tv_sec;
+    struct tm      tm;
+    const char    *field;
+    size_t         width;
+
+    switch ( group_by ) {
+    case GROUP_USER:
+        field = utbufp->ut_user;
+        width = sizeof(utbufp->ut_user);
+        break;
+    case GROUP_HOST:
+        field = utbufp->ut_host;
+        width = sizeof(utbufp->ut_host);
+        break;
+    case GROUP_LINE:
+        field = utbufp->ut_line;
+        width = sizeof(utbufp->ut_line);
+        break;
+    case GROUP_HOUR:
+    case GROUP_DAY:
+        if ( t < hour_start || t >= hour_end ) {
+            localtime_r(&t, &tm);
+            hour       = tm.tm_hour;
+            hour_start = t - tm.tm_min * 60 - tm.tm_sec;
+            hour_end   = hour_start + 3600;
+            tm.tm_sec  = tm.tm_min = tm.tm_hour = 0;
+            day        = timegm(&tm) / 86400;
+        }
+        if ( group_by == GROUP_HOUR )
+            hour_counts[hour]++;
+        else
+            count_day(day);
+        return;
+    default:
+        total++;
+        return;
+    }
+
+    if ( count_table_add(&keys, field, width, 1) == -1 )
+        die("Out of memory", "");
+}
+
+
+/* displays one line of the table: the key, padded to 32 columns, and its count */
+static void show_count( const char *key, long count )
+{
+    size_t  len;
+
+    if ( key[0] == '\0' )
+        key = "(none)";
+    len = strlen(key);
+    put_field(key, len, len < 32 ? 32 : 0);
+    put_char(' ');
+    put_long(count, 10);
+    put_char('\n');
+}
+
+
+/*****************************************************************************
+  print counts()
+  The string keys are sorted by count, largest first; the hours are shown
+  in order, all 24 of them, and the days in order, skipping those with no
+  records.
+ *****************************************************************************/
+void print_counts( int group_by )
+{
+    count_entry  *entries;
+    char          key[16];
+    struct tm     tm;
+    time_t        t;
+    long          i;
+    int           n;
+
+    switch ( group_by ) {
+    case GROUP_NONE:
+        put_long(total, 0);
+        put_char('\n');
+        break;
+    case GROUP_HOUR:
+        for ( i = 0; i < 24; i++ ) {
+            snprintf(key, sizeof(key), "%02ld:00", i);
+            show_count(key, hour_counts[i]);
+        }
+        break;
+    case GROUP_DAY:
+        for ( i = 0; i < ndays; i++ )
+            if ( day_counts[i] > 0 ) {
+                t = (first_day + i) * 86400;
+                gmtime_r(&t, &tm);
+                strftime(key, sizeof(key), "%Y-%m-%d", &tm);
+                show_count(key, day_counts[i]);
+            }
+        free(day_counts);
+        break;
+    default:
+        n = count_table_size(&keys);
+        if ( (entries = count_table_sorted(&keys, 1)) == NULL )
+            die("Out of memory", "");
+        for ( i = 0; i < n; i++ )
+            show_count(entries[i].key, entries[i].count);
+        free(entries);
+        count_table_free(&keys);
+    }
+}
+
+
 /*****************************************************************************
   show info()
   displays contents of the utmp struct in human readable form
-  The sizes used in the printf below are not guaranteed to work on all systems.
+  The field widths used below are not guaranteed to work on all systems.
   The ut_time member may be 32 or 64 bits.
   If the type of entry is not USER_PROCESS, it skips the record
  *****************************************************************************/
 void show_info( struct utmp *utbufp )
 {
     show_type(utbufp->ut_type);
-    printf("%-8.8s", utbufp->ut_name);      /* the logname  */
-    printf(" ");                            /* a space      */
-    printf("%-8.8s", utbufp->ut_line);      /* the tty      */
-    printf(" ");                            /* a space      */
-    show_time( utbufp->ut_time );           /* display time */
-    printf(" ");
-    printf("%-3d ", utbufp->ut_exit.e_exit);
-    printf("%-3d ", utbufp->ut_exit.e_termination);
+    put_field(utbufp->ut_name, sizeof(utbufp->ut_name), 8);  /* the logname */
+    put_char(' ');                          /* a space      */
+    put_field(utbufp->ut_line, sizeof(utbufp->ut_line), 8);  /* the tty     */
+    put_char(' ');                          /* a space      */
+    put_time( utbufp->ut_time );            /* display time */
+    put_char(' ');
+    put_long(utbufp->ut_exit.e_exit, -3);
+    put_char(' ');
+    put_long(utbufp->ut_exit.e_termination, -3);
+    put_char(' ');
 
 #ifdef SHOWHOST
-    if ( utbufp->ut_host[0] != '\0' )
-        printf(" (%s)", utbufp->ut_host);/* the host    */
+    if ( utbufp->ut_host[0] != '\0' ) {    /* the host     */
+        put_str(" (");
+        put_field(utbufp->ut_host, sizeof(utbufp->ut_host), 0);
+        put_char(')');
+    }
 #endif
-        printf("\n");
+    put_char('\n');
 }
 
 
@@ -115,14 +412,14 @@ void show_type( int t)
 {
     switch (t)
     {
-    case RUN_LVL:      	printf("RUN_LVL       "); break;
-    case BOOT_TIME:     printf("BOOT_TIME     "); break;
-    case NEW_TIME:      printf("NEW_TIME      "); break;
-    case OLD_TIME:      printf("OLD_TIME      "); break;
-    case INIT_PROCESS:  printf("INIT_PROCESS  "); break;
-    case LOGIN_PROCESS: printf("LOGIN_PROCESS "); break;
-    case USER_PROCESS:  printf("USER_PROCESS  "); break;
-    case DEAD_PROCESS:  printf("DEAD_PROCESS  "); break;
-    case ACCOUNTING:    printf("ACCOUNTING    "); break;
+    case RUN_LVL:      	put_str("RUN_LVL       "); break;
+    case BOOT_TIME:     put_str("BOOT_TIME     "); break;
+    case NEW_TIME:      put_str("NEW_TIME      "); break;
+    case OLD_TIME:      put_str("OLD_TIME      "); break;
+    case INIT_PROCESS:  put_str("INIT_PROCESS  "); break;
+    case LOGIN_PROCESS: put_str("LOGIN_PROCESS "); break;
+    case USER_PROCESS:  put_str("USER_PROCESS  "); break;
+    case DEAD_PROCESS:  put_str("DEAD_PROCESS  "); break;
+    case ACCOUNTING:    put_str("ACCOUNTING    "); break;
     }
 }
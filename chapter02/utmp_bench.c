@@ -0,0 +1,136 @@
+/******************************************************************************
+  Title          : utmp_bench.c
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Measures how fast the utmp_reader scans a utmp file
+  Purpose        : To show how the size of the read buffer affects the rate
+                   at which records can be read, and how reading through a
+                   buffer compares with reading a memory-mapped file
+  Usage          : utmp_bench <utmp-file> [bufsize ...]
+                   where each bufsize is a number of bytes, optionally
+                   followed by k or m. The default sizes run from the
+                   20 records per read() that utmp_utils.c used to use up to
+                   4 MB.
+  Build with     : gcc -o utmp_bench utmp_bench.c utmp_utils.c -I../include \
+                   -L../lib -lutils -lz -lpthread
+
+  Notes          : Run it twice in a row to see the numbers for a file that
+                   is in the page cache. Each scan touches every record, so
+                   the mapped scan is charged for its page faults.
+                   The buffer size shown is the one the reader used, which
+                   is the requested size rounded up to whole records, and
+                   to whole file system blocks if it is big enough.
+
+******************************************************************************
+ * Copyright (C) 2020 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "utmp_utils.h"
+#include "utils.h"
+
+static char *default_sizes[] = { "7680", "64k", "256k", "1m", "4m", NULL };
+
+/*****************************************************************************
+  scan( filename, flags, bufsize )
+  reads every record of the file with a new reader and prints the rate
+ *****************************************************************************/
+void scan( char *, int, size_t );
+
+/*****************************************************************************
+  parse_size( string )
+  returns the number of bytes in a string such as "64k" or "4m"
+ *****************************************************************************/
+size_t parse_size( char * );
+
+
+/*****************************************************************************
+                               Main Program
+*****************************************************************************/
+int main(int argc, char* argv[])
+{
+    char  **sizes = default_sizes;
+
+    if ( argc < 2 ) {
+        fprintf(stderr, "usage: %s <utmp-file> [bufsize ...]\n", argv[0]);
+        exit(1);
+    }
+    if ( argc > 2 )
+        sizes = &argv[2];
+
+    printf("%-12s %12s %10s %14s\n", "mode", "bufsize", "records",
+           "records/sec");
+    for ( ; *sizes != NULL; sizes++ )
+        scan( argv[1], UTMP_NOMAP, parse_size( *sizes ) );
+    scan( argv[1], 0, 0 );
+    return 0;
+}
+
+
+void scan( char *file, int flags, size_t bufsize )
+{
+    utmp_reader     *reader;
+    utmp_record     *rec;
+    struct timespec  start, stop;
+    long             count    = 0;
+    long             checksum = 0;   // keeps the loop from being optimized out
+    size_t           used;           // the buffer size after rounding
+    double           secs;
+
+    if ( (reader = utmp_reader_open_flags( file, flags, bufsize )) == NULL )
+        die( "Cannot open ", file );
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    while ( (rec = utmp_reader_next( reader )) != NULL_UTMP_RECORD_PTR ) {
+        checksum += rec->ut_type;
+        count++;
+    }
+    clock_gettime( CLOCK_MONOTONIC, &stop );
+    used = utmp_reader_bufsize( reader );
+    utmp_reader_close( reader );
+
+    secs = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+    if ( flags & UTMP_NOMAP )
+        printf("%-12s %12zu ", "buffered", used);
+    else
+        printf("%-12s %12s ", "mapped", "-");
+    printf("%10ld %14.0f\n", count, secs > 0 ? count / secs : 0.0);
+    if ( checksum < 0 )
+        printf("impossible checksum\n");
+}
+
+
+size_t parse_size( char *str )
+{
+    char   *end;
+    size_t  size = strtoul( str, &end, 10 );
+
+    if ( *end == 'k' || *end == 'K' )
+        size *= 1024;
+    else if ( *end == 'm' || *end == 'M' )
+        size *= 1024 * 1024;
+    if ( 0 == size ) {
+        fprintf(stderr, "bad buffer size: %s\n", str);
+        exit(1);
+    }
+    return size;
+}
@@ -0,0 +1,333 @@
+/******************************************************************************
+  Title          : utmp_filter.c
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Selects utmp records by user, line, host, type and time
+  Purpose        : To test raw records against a filter compiled once from
+                   the command line
+  Usage          : see utmp_filter.h
+  Build with     : gcc -c utmp_filter.c
+
+  Notes          : The filter is kept as a small program: an array of tests,
+                   with each group of tests followed by an END step. Each test
+                   knows where the next group begins, so a failed test jumps
+                   straight there, and reaching an END means the record
+                   matched. The groups are in the order they were given; the
+                   type test, if a group has one, is its first step.
+
+******************************************************************************
+ * Copyright (C) 2020 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+******************************************************************************/
+#define _GNU_SOURCE             /* for strptime() */
+#include  <stdlib.h>
+#include  <string.h>
+#include  <strings.h>
+#include  <stddef.h>
+#include  <limits.h>
+#include  <errno.h>
+#include  <utmp.h>
+#include "utmp_utils.h"
+#include "utmp_filter.h"
+
+#define START_STEPS   8
+
+/* what a step does */
+#define STEP_END      0     /* the record matched the group */
+#define STEP_TYPES    1     /* ut_type must be in types */
+#define STEP_FIELD    2     /* len bytes at offset must equal key */
+
+typedef struct {
+    int           op;
+    int           next_group;   /* where to go when the test fails; -1 if
+                                   this is the last group */
+    size_t        offset;       /* of the field in struct utmp */
+    size_t        len;          /* how many bytes of key to compare */
+    unsigned int  types;
+    char          key[UT_HOSTSIZE];
+} filter_step;
+
+struct utmp_filter {
+    filter_step  *steps;
+    int           nsteps;
+    int           room;
+    int           group;        /* first step of the current group */
+    unsigned int  types;        /* types the finished groups can match */
+    time_t        since;
+    time_t        until;
+};
+
+/* the type names, in the order of their values */
+static const char *type_names[] = {
+    "EMPTY", "RUN_LVL", "BOOT_TIME", "NEW_TIME", "OLD_TIME", "INIT_PROCESS",
+    "LOGIN_PROCESS", "USER_PROCESS", "DEAD_PROCESS", "ACCOUNTING", NULL
+};
+
+
+/******************************************************************************
+  Returns a new step at the end of the program, or NULL if out of memory.
+******************************************************************************/
+static filter_step *add_step( utmp_filter *f, int op )
+{
+    filter_step  *s;
+
+    if ( f->nsteps == f->room ) {
+        filter_step *bigger = realloc( f->steps,
+                                       2 * f->room * sizeof(filter_step) );
+        if ( bigger == NULL )
+            return NULL;
+        f->steps = bigger;
+        f->room *= 2;
+    }
+    s = &f->steps[f->nsteps++];
+    memset( s, 0, sizeof(*s) );
+    s->op         = op;
+    s->next_group = -1;
+    return s;
+}
+
+/******************************************************************************
+  Returns the mask of the types in a comma-separated list, or 0 if a name
+  in it is unknown.
+******************************************************************************/
+static unsigned int parse_types( const char *list )
+{
+    unsigned int  mask = 0;
+    const char   *p = list, *end;
+    size_t        len;
+    char         *num_end;
+    long          n;
+    int           i;
+
+    while ( *p != '\0' ) {
+        if ( (end = strchr( p, ',' )) == NULL )
+            end = p + strlen( p );
+        len = end - p;
+        n   = strtol( p, &num_end, 10 );
+        if ( num_end == end && len > 0 && n >= 0 && n < 32 )
+            mask |= UTMP_TYPE_MASK( n );
+        else {
+            for ( i = 0; type_names[i] != NULL; i++ )
+                if ( strlen( type_names[i] ) == len
+                     && strncasecmp( type_names[i], p, len ) == 0 )
+                    break;
+            if ( type_names[i] == NULL )
+                return 0;
+            mask |= UTMP_TYPE_MASK( i );
+        }
+        p = *end == ',' ? end + 1 : end;
+    }
+    return mask;
+}
+
+/******************************************************************************
+  Returns the types that the current group can match. An empty group after
+  the first matches nothing, since the group before it ended with an "or"
+  that nothing followed.
+******************************************************************************/
+static unsigned int group_types( const utmp_filter *f )
+{
+    if ( f->group == f->nsteps && f->group > 0 )
+        return 0;
+    if ( f->group < f->nsteps && f->steps[f->group].op == STEP_TYPES )
+        return f->steps[f->group].types;
+    return UTMP_ALL_TYPES;
+}
+
+
+utmp_filter *utmp_filter_new( void )
+{
+    utmp_filter  *f;
+
+    if ( (f = calloc( 1, sizeof(utmp_filter) )) == NULL )
+        return NULL;
+    if ( (f->steps = malloc( START_STEPS * sizeof(filter_step) )) == NULL ) {
+        free( f );
+        return NULL;
+    }
+    f->room  = START_STEPS;
+    f->since = LONG_MIN;
+    f->until = LONG_MAX;
+    return f;
+}
+
+
+int utmp_filter_add( utmp_filter *f, int field, const char *value )
+{
+    filter_step  *s;
+    unsigned int  types;
+    size_t        offset, size, len;
+    int           prefix;
+
+    switch ( field ) {
+    case UTMP_FILTER_USER:
+        offset = offsetof( struct utmp, ut_user );
+        size   = sizeof( ((struct utmp *) 0)->ut_user );
+        break;
+    case UTMP_FILTER_LINE:
+        offset = offsetof( struct utmp, ut_line );
+        size   = sizeof( ((struct utmp *) 0)->ut_line );
+        break;
+    case UTMP_FILTER_HOST:
+        offset = offsetof( struct utmp, ut_host );
+        size   = sizeof( ((struct utmp *) 0)->ut_host );
+        break;
+    case UTMP_FILTER_TYPE:
+        if ( (types = parse_types( value )) == 0 ) {
+            errno = EINVAL;
+            return -1;
+        }
+        // merge it into the group's type test, which is the group's first step
+        if ( f->group < f->nsteps && f->steps[f->group].op == STEP_TYPES ) {
+            f->steps[f->group].types &= types;
+            return 0;
+        }
+        if ( add_step( f, STEP_TYPES ) == NULL ) {
+            errno = ENOMEM;
+            return -1;
+        }
+        s = &f->steps[f->group];
+        memmove( s + 1, s, ( f->nsteps - 1 - f->group ) * sizeof(filter_step) );
+        memset( s, 0, sizeof(*s) );
+        s->op         = STEP_TYPES;
+        s->next_group = -1;
+        s->types      = types;
+        return 0;
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+
+    len    = strlen( value );
+    prefix = len > 0 && value[len - 1] == '*';
+    if ( prefix )
+        len--;
+    if ( len > size ) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ( (s = add_step( f, STEP_FIELD )) == NULL ) {
+        errno = ENOMEM;
+        return -1;
+    }
+    s->offset = offset;
+    memcpy( s->key, value, len );
+    // an exact match also compares the NUL that ends a short value, but not
+    // the bytes after it, which a careless writer may have left unzeroed
+    s->len = ( prefix || len == size ) ? len : len + 1;
+    return 0;
+}
+
+
+int utmp_filter_or( utmp_filter *f )
+{
+    int  i;
+
+    if ( f->group == f->nsteps )
+        return 0;
+    f->types |= group_types( f );
+    if ( add_step( f, STEP_END ) == NULL )
+        return -1;
+    for ( i = f->group; i < f->nsteps; i++ )
+        f->steps[i].next_group = f->nsteps;
+    f->group = f->nsteps;
+    return 0;
+}
+
+
+void utmp_filter_range( utmp_filter *f, time_t since, time_t until )
+{
+    f->since = since;
+    f->until = until;
+}
+
+
+int utmp_filter_parse_time( const char *arg, time_t *t )
+{
+    static const char *formats[] = { "%Y-%m-%d %H:%M:%S", "%Y-%m-%d %H:%M",
+                                     "%Y-%m-%d", NULL };
+    struct tm    tm;
+    const char **fmt;
+    char        *end;
+
+    if ( arg[0] == '@' ) {
+        *t = strtoll( arg + 1, &end, 10 );
+        return ( *end == '\0' && end != arg + 1 ) ? 0 : -1;
+    }
+    for ( fmt = formats; *fmt != NULL; fmt++ ) {
+        memset( &tm, 0, sizeof(tm) );
+        end = strptime( arg, *fmt, &tm );
+        if ( end != NULL && *end == '\0' ) {
+            tm.tm_isdst = -1;
+            *t = mktime( &tm );
+            return 0;
+        }
+    }
+    return -1;
+}
+
+
+unsigned int utmp_filter_types( const utmp_filter *f )
+{
+    return f->types | group_types( f );
+}
+
+
+int utmp_filter_match( const utmp_filter *f, const struct utmp *rec )
+{
+    const filter_step  *s;
+    int                 i = 0;
+
+    if ( rec->ut_tv.tv_sec < f->since || rec->ut_tv.tv_sec > f->until )
+        return 0;
+    while ( i < f->nsteps ) {
+        s = &f->steps[i];
+        switch ( s->op ) {
+        case STEP_END:
+            return 1;
+        case STEP_TYPES:
+            if ( (unsigned) rec->ut_type < 32
+                 && ( s->types & UTMP_TYPE_MASK( rec->ut_type ) ) ) {
+                i++;
+                continue;
+            }
+            break;
+        default:
+            if ( memcmp( (const char *) rec + s->offset, s->key, s->len ) == 0 ) {
+                i++;
+                continue;
+            }
+            break;
+        }
+        // the test failed: try the next group, if there is one
+        if ( s->next_group == -1 )
+            return 0;
+        i = s->next_group;
+    }
+    // the last group has no END step; it matched if it was not empty
+    return f->group < f->nsteps || f->group == 0;
+}
+
+
+void utmp_filter_free( utmp_filter *f )
+{
+    if ( f == NULL )
+        return;
+    free( f->steps );
+    free( f );
+}
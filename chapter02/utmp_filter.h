@@ -0,0 +1,121 @@
+/******************************************************************************
+  Title          : utmp_filter.h
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Selects utmp records by user, line, host, type and time
+  Purpose        : To let programs like show_utmp skip the records they are
+                   not asked for before spending any time formatting them
+  Build with     : compile utmp_filter.c with the program
+
+******************************************************************************
+ * Copyright (C) 2020 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+******************************************************************************/
+
+#ifndef __UTMP_FILTER_H__
+#define __UTMP_FILTER_H__
+
+#include <time.h>
+#include <utmp.h>
+
+/*
+   The fields a test can look at
+*/
+#define UTMP_FILTER_USER   0    /* ut_user equals the value              */
+#define UTMP_FILTER_LINE   1    /* ut_line equals the value              */
+#define UTMP_FILTER_HOST   2    /* ut_host equals the value              */
+#define UTMP_FILTER_TYPE   3    /* ut_type is one of a list of types     */
+
+/*
+   A utmp_filter is a list of groups of tests. A record matches a group if
+   it passes every test in it, and matches the filter if it matches any
+   group and its time is in the filter's range. A new filter has one empty
+   group, which every record matches, and the range of all times.
+   The tests are compiled as they are added: a string value is copied into
+   a key padded with NULs to the width of its field, so that the test is a
+   single memcmp() against the record, and all the type tests of a group
+   are merged into one bit mask that is tested before anything else.
+*/
+typedef struct utmp_filter utmp_filter;
+
+
+/*****************************************************************************
+ utmp_filter_new()
+ returns: a new filter that matches every record
+          NULL if out of memory
+ *****************************************************************************/
+utmp_filter *utmp_filter_new( void );
+
+/*****************************************************************************
+ utmp_filter_add( filter, field, value )
+ adds a test of the given field to the current group. For the string fields
+ the value must equal the field, unless it ends in '*', in which case the
+ field must begin with what comes before the '*'. For UTMP_FILTER_TYPE the
+ value is a comma-separated list of type names as show_utmp prints them,
+ such as "USER_PROCESS,DEAD_PROCESS", in either case, or type numbers.
+ returns: 0 on success
+          -1 with errno EINVAL if the field or a type name is unknown or
+          the value is longer than the field, ENOMEM if out of memory
+ *****************************************************************************/
+int utmp_filter_add( utmp_filter *, int, const char * );
+
+/*****************************************************************************
+ utmp_filter_or( filter )
+ starts a new group, so that the tests added after it are an alternative
+ to those added before it. It does nothing if the current group is empty,
+ and a group left empty at the end matches nothing.
+ returns: 0 on success, -1 if out of memory
+ *****************************************************************************/
+int utmp_filter_or( utmp_filter * );
+
+/*****************************************************************************
+ utmp_filter_range( filter, since, until )
+ makes the filter match only records whose ut_tv.tv_sec is at least since
+ and at most until, whatever group they match
+ *****************************************************************************/
+void utmp_filter_range( utmp_filter *, time_t, time_t );
+
+/*****************************************************************************
+ utmp_filter_parse_time( string, time )
+ converts a time given on a command line, which is "YYYY-MM-DD",
+ "YYYY-MM-DD HH:MM" or "YYYY-MM-DD HH:MM:SS" in local time, or "@" followed
+ by seconds since the Epoch, and stores it in *time
+ returns: 0 on success, -1 if the string is not in one of those forms
+ *****************************************************************************/
+int utmp_filter_parse_time( const char *, time_t * );
+
+/*****************************************************************************
+ utmp_filter_types( filter )
+ returns: the mask, as a bitwise OR of UTMP_TYPE_MASK() values, of the
+          types a record can have and still match, which can be given to
+          utmp_reader_set_types() so that the reader skips the others
+ *****************************************************************************/
+unsigned int utmp_filter_types( const utmp_filter * );
+
+/*****************************************************************************
+ utmp_filter_match( filter, record )
+ returns: 1 if the record matches the filter, 0 if not
+ *****************************************************************************/
+int utmp_filter_match( const utmp_filter *, const struct utmp * );
+
+/*****************************************************************************
+ utmp_filter_free( filter )  frees the filter
+ *****************************************************************************/
+void utmp_filter_free( utmp_filter * );
+
+#endif /* __UTMP_FILTER_H__ */
@@ -0,0 +1,487 @@
+/******************************************************************************
+  Title          : utmp_gen.c
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Generates synthetic but realistic wtmp records
+  Purpose        : To make wtmp files of any size for testing and timing the
+                   programs that read them
+  Usage          : see utmp_gen.h
+  Build with     : gcc -c utmp_gen.c
+
+  Notes          : The generator simulates one system. Logins arrive at
+                   random on free lines; each login draws the length of its
+                   session, and the open sessions are kept in a heap ordered
+                   by the time they end, so that the logouts come out in time
+                   order among the logins. Reboots and clock changes produce
+                   several records at once, which wait in a small queue.
+                   The random numbers come from a xorshift64* generator
+                   seeded from the config, not from rand(), so that a seed
+                   means the same file on every system.
+
+******************************************************************************
+ * Copyright (C) 2020 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+******************************************************************************/
+#include  <stdlib.h>
+#include  <string.h>
+#include  <stdint.h>
+#include  <errno.h>
+#include  <math.h>
+#include  <fcntl.h>
+#include  <unistd.h>
+#include  <arpa/inet.h>
+#include  <utmp.h>
+#include "utmp_gen.h"
+
+#define GEN_BATCH     10922     /* records per write(), about 4 MB */
+#define FIRST_PID     300       /* pids wrap around to this, as Linux's do */
+#define LAST_PID      32767
+#define MAX_PENDING   4         /* records a reboot or clock change makes */
+
+/* an open session, which ends at time end */
+typedef struct {
+    time_t  end;
+    int     line;
+    int     pid;
+} gen_session;
+
+struct utmp_gen {
+    utmp_gen_config  cfg;
+    uint64_t         rng;
+    time_t           now;           /* time of the latest record */
+    time_t           next_login;
+    gen_session     *heap;          /* open sessions, earliest end first */
+    int              open;
+    int             *free_lines;    /* a stack of the lines not in use */
+    int              nfree;
+    int              next_pid;
+    long             until_boot;    /* records until the next reboot */
+    long             until_jump;    /* records until the next clock change */
+    struct utmp      pending[MAX_PENDING];
+    int              npending;
+    int              next_pending;
+};
+
+
+void utmp_gen_defaults( utmp_gen_config *cfg )
+{
+    memset( cfg, 0, sizeof(*cfg) );
+    cfg->seed          = 1;
+    cfg->users         = 500;
+    cfg->lines         = 64;
+    cfg->hosts         = 100;
+    cfg->distribution  = UTMP_GEN_EXP;
+    cfg->mean_session  = 1800;
+    cfg->mean_gap      = 60;
+    cfg->boot_every    = 50000;
+    cfg->crash_percent = 10;
+    cfg->jump_every    = 0;
+    cfg->max_jump      = 3600;
+    cfg->start         = 1577836800;     // Jan 1 2020 00:00:00 UTC
+}
+
+
+/******************************************************************************
+                         Random numbers
+******************************************************************************/
+
+/* returns the next 64 random bits */
+static uint64_t next_random( utmp_gen *g )
+{
+    g->rng ^= g->rng >> 12;
+    g->rng ^= g->rng << 25;
+    g->rng ^= g->rng >> 27;
+    return g->rng * 0x2545F4914F6CDD1DULL;
+}
+
+/* returns a random number in [0,1) */
+static double uniform( utmp_gen *g )
+{
+    return ( next_random( g ) >> 11 ) * 0x1.0p-53;
+}
+
+/* returns a random integer in [0,n) */
+static long below( utmp_gen *g, long n )
+{
+    return (long) ( uniform( g ) * n );
+}
+
+/* returns a random number of seconds, exponentially distributed */
+static long exp_seconds( utmp_gen *g, long mean )
+{
+    return (long) ( -mean * log( 1.0 - uniform( g ) ) );
+}
+
+/* returns the length of a new session */
+static long session_length( utmp_gen *g )
+{
+    long    mean = g->cfg.mean_session;
+    double  x;
+
+    switch ( g->cfg.distribution ) {
+    case UTMP_GEN_UNIFORM:
+        return below( g, 2 * mean + 1 );
+    case UTMP_GEN_PARETO:
+        // shape 2 and scale mean/2 have the given mean; cut the tail off
+        // at 1000 means so that no session outlasts the file
+        x = mean / 2.0 / sqrt( 1.0 - uniform( g ) );
+        return x < 1000.0 * mean ? (long) x : 1000 * mean;
+    default:
+        return exp_seconds( g, mean );
+    }
+}
+
+/* returns how many records to write before the next event that happens
+   about every records */
+static long countdown( utmp_gen *g, long every )
+{
+    return every / 2 + below( g, every ) + 1;
+}
+
+
+/******************************************************************************
+                         The heap of open sessions
+******************************************************************************/
+
+static void heap_push( utmp_gen *g, gen_session s )
+{
+    int  i = g->open++, parent;
+
+    while ( i > 0 && g->heap[parent = (i - 1) / 2].end > s.end ) {
+        g->heap[i] = g->heap[parent];
+        i = parent;
+    }
+    g->heap[i] = s;
+}
+
+static gen_session heap_pop( utmp_gen *g )
+{
+    gen_session  top  = g->heap[0];
+    gen_session  last = g->heap[--g->open];
+    int          i = 0, child;
+
+    while ( (child = 2 * i + 1) < g->open ) {
+        if ( child + 1 < g->open && g->heap[child + 1].end < g->heap[child].end )
+            child++;
+        if ( last.end <= g->heap[child].end )
+            break;
+        g->heap[i] = g->heap[child];
+        i = child;
+    }
+    g->heap[i] = last;
+    return top;
+}
+
+
+/******************************************************************************
+                         Filling in records
+******************************************************************************/
+
+/* copies prefix, then n in decimal, then suffix into a field of size bytes,
+   cutting it off at size bytes as the utmp fields are */
+static void put_name( char *field, size_t size, const char *prefix, long n,
+                      const char *suffix )
+{
+    char    buf[64];
+    char    digits[24];
+    char   *d = digits + sizeof(digits);
+    size_t  len = strlen( prefix ), k;
+
+    memcpy( buf, prefix, len );
+    do {
+        *--d = '0' + n % 10;
+        n /= 10;
+    } while ( n > 0 );
+    k = digits + sizeof(digits) - d;
+    memcpy( buf + len, d, k );
+    len += k;
+    k = strlen( suffix );
+    memcpy( buf + len, suffix, k );
+    len += k;
+    memcpy( field, buf, len < size ? len : size );
+}
+
+static void set_time( utmp_gen *g, struct utmp *u, time_t t )
+{
+    u->ut_tv.tv_sec  = t;
+    u->ut_tv.tv_usec = below( g, 1000000 );
+}
+
+/* the ut_line and ut_id of a line: the id is the last four characters of
+   the line, as sshd writes it */
+static void set_line( struct utmp *u, int line )
+{
+    size_t  len;
+
+    put_name( u->ut_line, sizeof(u->ut_line), "pts/", line, "" );
+    len = strnlen( u->ut_line, sizeof(u->ut_line) );
+    if ( len <= sizeof(u->ut_id) )
+        memcpy( u->ut_id, u->ut_line, len );
+    else
+        memcpy( u->ut_id, u->ut_line + len - sizeof(u->ut_id),
+                sizeof(u->ut_id) );
+}
+
+/* a record with the given type, line, id and user, for the queue */
+static struct utmp *queue_record( utmp_gen *g, short type, const char *line,
+                                  const char *user, time_t t )
+{
+    struct utmp  *u = &g->pending[g->npending++];
+
+    memset( u, 0, sizeof(*u) );
+    u->ut_type = type;
+    strncpy( u->ut_line, line, sizeof(u->ut_line) );
+    strncpy( u->ut_id, "~~", sizeof(u->ut_id) );
+    strncpy( u->ut_user, user, sizeof(u->ut_user) );
+    set_time( g, u, t );
+    return u;
+}
+
+/* queues the records of a boot at time t and closes every session */
+static void boot( utmp_gen *g, time_t t )
+{
+    struct utmp  *u;
+
+    u = queue_record( g, BOOT_TIME, "~", "reboot", t );
+    strncpy( u->ut_host, "5.4.0-synthetic", sizeof(u->ut_host) );
+    u = queue_record( g, RUN_LVL, "~", "runlevel", t + 5 );
+    u->ut_pid = '5' + 256 * 'N';
+    strncpy( u->ut_host, "5.4.0-synthetic", sizeof(u->ut_host) );
+    g->now = t + 5;
+    g->next_login = g->now + exp_seconds( g, g->cfg.mean_gap );
+
+    while ( g->open > 0 )
+        g->free_lines[g->nfree++] = heap_pop( g ).line;
+}
+
+/* queues a shutdown, unless this is a crash, and the boot after it */
+static void reboot( utmp_gen *g )
+{
+    time_t  t = g->now + 1 + exp_seconds( g, g->cfg.mean_gap );
+    int     crash = below( g, 100 ) < g->cfg.crash_percent;
+
+    if ( ! crash ) {
+        queue_record( g, RUN_LVL, "~~", "shutdown", t );
+        g->pending[g->npending - 1].ut_pid = '0' + 256 * '5';
+    }
+    boot( g, t + 30 + below( g, 300 ) );
+}
+
+/* queues the records of setting the clock, and moves every time ahead of
+   the simulation by the same amount */
+static void clock_jump( utmp_gen *g )
+{
+    long  delta = below( g, 2 * g->cfg.max_jump + 1 ) - g->cfg.max_jump;
+    int   i;
+
+    if ( delta == 0 )
+        delta = 1;
+    queue_record( g, OLD_TIME, "|", "date", g->now );
+    queue_record( g, NEW_TIME, "{", "date", g->now + delta );
+    g->now        += delta;
+    g->next_login += delta;
+    for ( i = 0; i < g->open; i++ )
+        g->heap[i].end += delta;
+}
+
+static void new_login( utmp_gen *g, struct utmp *u )
+{
+    gen_session  s;
+    long         host;
+
+    g->now = g->next_login > g->now ? g->next_login : g->now;
+    g->next_login = g->now + exp_seconds( g, g->cfg.mean_gap );
+
+    s.line = g->free_lines[--g->nfree];
+    s.pid  = g->next_pid;
+    s.end  = g->now + session_length( g );
+    g->next_pid = g->next_pid == LAST_PID ? FIRST_PID : g->next_pid + 1;
+    heap_push( g, s );
+
+    host = below( g, g->cfg.hosts );
+    u->ut_type    = USER_PROCESS;
+    u->ut_pid     = s.pid;
+    u->ut_session = s.pid;
+    set_line( u, s.line );
+    put_name( u->ut_user, sizeof(u->ut_user), "user",
+              below( g, g->cfg.users ), "" );
+    put_name( u->ut_host, sizeof(u->ut_host), "host", host, ".example.com" );
+    u->ut_addr_v6[0] = htonl( ( 10u << 24 ) | (uint32_t) host );
+    set_time( g, u, g->now );
+}
+
+static void new_logout( utmp_gen *g, struct utmp *u )
+{
+    gen_session  s = heap_pop( g );
+
+    g->free_lines[g->nfree++] = s.line;
+    g->now = s.end > g->now ? s.end : g->now;
+
+    u->ut_type = DEAD_PROCESS;
+    u->ut_pid  = s.pid;
+    set_line( u, s.line );
+    set_time( g, u, g->now );
+}
+
+/* writes the next record into *u */
+static void next_record( utmp_gen *g, struct utmp *u )
+{
+    if ( g->next_pending == g->npending ) {
+        g->next_pending = g->npending = 0;
+        if ( g->cfg.boot_every > 0 && --g->until_boot == 0 ) {
+            g->until_boot = countdown( g, g->cfg.boot_every );
+            reboot( g );
+        }
+        else if ( g->cfg.jump_every > 0 && --g->until_jump == 0 ) {
+            g->until_jump = countdown( g, g->cfg.jump_every );
+            clock_jump( g );
+        }
+    }
+    if ( g->next_pending < g->npending ) {
+        *u = g->pending[g->next_pending++];
+        return;
+    }
+
+    memset( u, 0, sizeof(*u) );
+    if ( g->open > 0 && ( g->nfree == 0 || g->heap[0].end <= g->next_login ) )
+        new_logout( g, u );
+    else
+        new_login( g, u );
+}
+
+
+/******************************************************************************
+                         The public functions
+******************************************************************************/
+
+utmp_gen *utmp_gen_new( const utmp_gen_config *cfg )
+{
+    utmp_gen  *g;
+    int        i;
+
+    if ( cfg->users < 1 || cfg->lines < 1 || cfg->hosts < 1
+         || cfg->hosts > ( 1 << 24 )
+         || cfg->distribution < UTMP_GEN_EXP
+         || cfg->distribution > UTMP_GEN_PARETO
+         || cfg->mean_session < 0 || cfg->mean_gap < 0
+         || cfg->boot_every < 0 || cfg->jump_every < 0 || cfg->max_jump < 0
+         || cfg->crash_percent < 0 || cfg->crash_percent > 100 ) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if ( (g = calloc( 1, sizeof(utmp_gen) )) == NULL )
+        return NULL;
+    g->heap       = malloc( cfg->lines * sizeof(gen_session) );
+    g->free_lines = malloc( cfg->lines * sizeof(int) );
+    if ( g->heap == NULL || g->free_lines == NULL ) {
+        utmp_gen_free( g );
+        return NULL;
+    }
+    g->cfg = *cfg;
+
+    // mix the seed so that nearby seeds start far apart; the state must
+    // not be zero
+    g->rng = ( cfg->seed + 0x9E3779B97F4A7C15ULL ) * 0xBF58476D1CE4E5B9ULL;
+    g->rng ^= g->rng >> 31;
+    if ( g->rng == 0 )
+        g->rng = 1;
+
+    // lines are handed out from the top of the stack, lowest number first
+    for ( i = 0; i < cfg->lines; i++ )
+        g->free_lines[i] = cfg->lines - 1 - i;
+    g->nfree    = cfg->lines;
+    g->next_pid = FIRST_PID;
+    if ( cfg->boot_every > 0 )
+        g->until_boot = countdown( g, cfg->boot_every );
+    if ( cfg->jump_every > 0 )
+        g->until_jump = countdown( g, cfg->jump_every );
+    boot( g, cfg->start );
+    return g;
+}
+
+
+void utmp_gen_fill( utmp_gen *g, struct utmp *records, long n )
+{
+    long  i;
+
+    for ( i = 0; i < n; i++ )
+        next_record( g, &records[i] );
+}
+
+
+void utmp_gen_free( utmp_gen *g )
+{
+    if ( g == NULL )
+        return;
+    free( g->heap );
+    free( g->free_lines );
+    free( g );
+}
+
+
+int utmp_gen_write( const utmp_gen_config *cfg, const char *filename,
+                    long count )
+{
+    utmp_gen     *g;
+    struct utmp  *batch;
+    char         *p;
+    long          k;
+    size_t        left;
+    ssize_t       n;
+    int           fd, saved_errno;
+
+    if ( strcmp( filename, "-" ) == 0 )
+        fd = 1;
+    else if ( (fd = open( filename, O_WRONLY | O_CREAT | O_TRUNC, 0644 )) == -1 )
+        return -1;
+    g     = utmp_gen_new( cfg );
+    batch = malloc( GEN_BATCH * sizeof(struct utmp) );
+    if ( g == NULL || batch == NULL )
+        goto fail;
+
+    while ( count > 0 ) {
+        k = count < GEN_BATCH ? count : GEN_BATCH;
+        utmp_gen_fill( g, batch, k );
+        p    = (char *) batch;
+        left = k * sizeof(struct utmp);
+        while ( left > 0 ) {
+            if ( (n = write( fd, p, left )) == -1 ) {
+                if ( errno == EINTR )
+                    continue;
+                goto fail;
+            }
+            p    += n;
+            left -= n;
+        }
+        count -= k;
+    }
+    free( batch );
+    utmp_gen_free( g );
+    if ( fd != 1 && close( fd ) == -1 )
+        return -1;
+    return 0;
+
+fail:
+    saved_errno = errno;
+    free( batch );
+    utmp_gen_free( g );
+    if ( fd != 1 )
+        close( fd );
+    errno = saved_errno;
+    return -1;
+}
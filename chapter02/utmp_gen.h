@@ -0,0 +1,116 @@
+/******************************************************************************
+  Title          : utmp_gen.h
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Generates synthetic but realistic wtmp records
+  Purpose        : To make wtmp files of any size for testing and timing the
+                   programs that read them, without using anyone's real
+                   login records
+  Build with     : compile utmp_gen.c with the program, and link with -lm
+
+******************************************************************************
+ * Copyright (C) 2020 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+******************************************************************************/
+
+#ifndef __UTMP_GEN_H__
+#define __UTMP_GEN_H__
+
+#include <time.h>
+#include <utmp.h>
+
+/*
+   How session lengths are distributed around their mean
+*/
+#define UTMP_GEN_EXP       0    /* exponential: many short, a few long     */
+#define UTMP_GEN_UNIFORM   1    /* uniform between 0 and twice the mean    */
+#define UTMP_GEN_PARETO    2    /* Pareto with shape 2: a long, heavy tail */
+
+/*
+   What to generate. Users, lines and hosts are numbered from 0 and named
+   user<n>, pts/<n> and host<n>.example.com; a line can hold only one
+   session at a time, so lines bounds how many sessions are open at once.
+   Logins arrive at random, mean_gap seconds apart on average. About every
+   boot_every records the system goes down and boots again, closing every
+   open session; crash_percent of those are crashes, which leave no shutdown
+   record. About every jump_every records the clock is set, by up to
+   max_jump seconds either way, which writes an OLD_TIME and a NEW_TIME
+   record. A zero boot_every or jump_every turns those off.
+   The same config always generates the same records.
+*/
+typedef struct {
+    unsigned long  seed;
+    int            users;
+    int            lines;
+    int            hosts;
+    int            distribution;     /* one of the UTMP_GEN_ values above */
+    long           mean_session;     /* seconds */
+    long           mean_gap;         /* seconds */
+    long           boot_every;       /* records */
+    int            crash_percent;
+    long           jump_every;       /* records */
+    long           max_jump;         /* seconds */
+    time_t         start;            /* time of the first boot */
+} utmp_gen_config;
+
+/*
+   A utmp_gen holds the state of the simulated system: the clock, the open
+   sessions and the free lines. Its contents are private to utmp_gen.c.
+*/
+typedef struct utmp_gen utmp_gen;
+
+
+/*****************************************************************************
+ utmp_gen_defaults( config )
+ fills config with a small, busy system: 500 users on 64 lines from 100
+ hosts, exponential sessions of 30 minutes a minute apart, a reboot about
+ every 50000 records of which 10% are crashes, no clock jumps, seed 1, and
+ a start of Jan 1 2020.
+ *****************************************************************************/
+void utmp_gen_defaults( utmp_gen_config * );
+
+/*****************************************************************************
+ utmp_gen_new( config )
+ returns: a new generator, whose first record is the BOOT_TIME record of
+          the first boot
+          NULL if the config is invalid (errno EINVAL) or out of memory
+ *****************************************************************************/
+utmp_gen *utmp_gen_new( const utmp_gen_config * );
+
+/*****************************************************************************
+ utmp_gen_fill( gen, records, n )
+ writes the next n records into the array records, zeroing each first
+ *****************************************************************************/
+void utmp_gen_fill( utmp_gen *, struct utmp *, long );
+
+/*****************************************************************************
+ utmp_gen_free( gen )  frees the generator
+ *****************************************************************************/
+void utmp_gen_free( utmp_gen * );
+
+/*****************************************************************************
+ utmp_gen_write( config, filename, count )
+ writes count records generated from config to the file, which is created
+ or truncated; a filename of "-" writes to the standard output. The
+ records are written several thousand at a time.
+ returns: 0 on success
+          -1 on error, with errno set
+ *****************************************************************************/
+int utmp_gen_write( const utmp_gen_config *, const char *, long );
+
+#endif /* __UTMP_GEN_H__ */
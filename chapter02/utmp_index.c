@@ -0,0 +1,317 @@
+/******************************************************************************
+  Title          : utmp_index.c
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : A sparse time index kept beside a wtmp file
+  Purpose        : Lets a program that wants records from a range of times
+                   start reading near the first of them instead of at the
+                   beginning of the file
+  Build with     : gcc -c utmp_index.c -I../include
+
+  Notes          : The index file is a header followed by one entry per block
+                   of records, all in the byte order of the machine that
+                   wrote it. It is a cache: if anything about it looks
+                   wrong, it is thrown away and built again.
+
+******************************************************************************
+ * Copyright (C) 2020 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+******************************************************************************/
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <stdint.h>
+#include  <unistd.h>
+#include  <fcntl.h>
+#include  <sys/types.h>
+#include  <utmp.h>
+#include "utmp_utils.h"
+#include "utmp_index.h"
+
+#define INDEX_MAGIC    "UTMPIDX1"
+#define INDEX_SUFFIX   ".idx"
+#define BATCH_SIZE     1024
+
+struct index_header {
+    char     magic[8];
+    int32_t  interval;          // records per block
+    int32_t  reserved;
+    int64_t  nrecs;             // records of the wtmp file covered
+    int64_t  first_sec;         // time of record 0, to recognize the file
+    int64_t  first_usec;
+};
+
+struct index_entry {
+    int64_t  offset;            // byte offset of the block's first record
+    int64_t  min_sec;           // smallest tv_sec in the block
+    int64_t  max_sec;           // largest tv_sec in the block
+};
+
+struct utmp_index {
+    int                  interval;
+    long                 nrecs;
+    long                 nblocks;
+    struct index_entry  *entries;
+    int64_t             *prefix_max;   // largest tv_sec in blocks 0..b
+    int64_t             *suffix_min;   // smallest tv_sec in blocks b..end
+};
+
+static long read_index( int, struct index_header *, utmp_index *, long );
+static int  extend_index( utmp_index *, utmp_reader *, long );
+static int  write_index( int, struct index_header *, utmp_index *, long );
+
+
+/*****************************************************************************
+  utmp_index_open( utmp_file, index_file, interval )
+  loads, updates and saves the index of utmp_file. See utmp_index.h.
+ *****************************************************************************/
+utmp_index *utmp_index_open( const char *utmp_file, const char *index_file,
+                             int interval )
+{
+    utmp_index          *idx;
+    utmp_reader         *reader;
+    utmp_record         *first;
+    struct index_header  hdr;
+    char                *path = NULL;
+    int                  fd;
+    long                 nrecs, kept, b;
+
+    if ( (reader = utmp_reader_open( utmp_file )) == NULL )
+        return NULL;
+    if ( (nrecs = utmp_reader_count( reader )) < 0
+           || (idx = calloc( 1, sizeof(utmp_index) )) == NULL ) {
+        utmp_reader_close( reader );
+        return NULL;
+    }
+    // records appended while the index is being built are left for next time
+    utmp_reader_set_limit( reader, nrecs );
+
+    if ( NULL == index_file ) {
+        if ( (path = malloc( strlen(utmp_file) + sizeof(INDEX_SUFFIX) )) == NULL )
+            goto fail;
+        strcpy( path, utmp_file );
+        strcat( path, INDEX_SUFFIX );
+        index_file = path;
+    }
+    if ( (fd = open( index_file, O_RDWR | O_CREAT, 0644 )) == -1 )
+        goto fail;
+
+    // what the header must say for the saved entries to be of any use
+    memset( &hdr, 0, sizeof(hdr) );
+    memcpy( hdr.magic, INDEX_MAGIC, sizeof(hdr.magic) );
+    hdr.interval = interval > 0 ? interval : UTMP_INDEX_INTERVAL;
+    if ( (first = utmp_reader_next( reader )) != NULL_UTMP_RECORD_PTR ) {
+        hdr.first_sec  = first->ut_tv.tv_sec;
+        hdr.first_usec = first->ut_tv.tv_usec;
+    }
+    idx->interval = hdr.interval;
+
+    // keep the complete blocks of a valid index; redo the last partial one
+    kept = read_index( fd, &hdr, idx, nrecs );
+    if ( extend_index( idx, reader, kept ) == -1 )
+        goto fail_fd;
+    if ( idx->nrecs != hdr.nrecs && write_index( fd, &hdr, idx, kept ) == -1 )
+        goto fail_fd;
+    close( fd );
+    utmp_reader_close( reader );
+    free( path );
+
+    idx->prefix_max = malloc( (idx->nblocks + 1) * sizeof(int64_t) );
+    idx->suffix_min = malloc( (idx->nblocks + 1) * sizeof(int64_t) );
+    if ( idx->prefix_max == NULL || idx->suffix_min == NULL ) {
+        utmp_index_close( idx );
+        return NULL;
+    }
+    for ( b = 0; b < idx->nblocks; b++ )
+        idx->prefix_max[b] = ( b > 0 && idx->prefix_max[b-1] > idx->entries[b].max_sec )
+                             ? idx->prefix_max[b-1] : idx->entries[b].max_sec;
+    for ( b = idx->nblocks - 1; b >= 0; b-- )
+        idx->suffix_min[b] = ( b < idx->nblocks - 1
+                               && idx->suffix_min[b+1] < idx->entries[b].min_sec )
+                             ? idx->suffix_min[b+1] : idx->entries[b].min_sec;
+    return idx;
+
+fail_fd:
+    close( fd );
+fail:
+    utmp_reader_close( reader );
+    free( path );
+    free( idx->entries );
+    free( idx );
+    return NULL;
+}
+
+
+/*****************************************************************************
+  utmp_index_range( index, since, until, first, end )
+  Records before the first block whose running maximum time reaches since
+  are all too early, and records after the last block whose running minimum
+  time, taken from the end of the file, is no later than until are all too
+  late. Both running values are monotonic, so both blocks are found by a
+  binary search.
+ *****************************************************************************/
+void utmp_index_range( utmp_index *idx, time_t since, time_t until,
+                       long *first, long *end )
+{
+    long  lo, hi, mid;
+
+    // first block b with prefix_max[b] >= since
+    for ( lo = 0, hi = idx->nblocks; lo < hi; ) {
+        mid = lo + (hi - lo) / 2;
+        if ( idx->prefix_max[mid] >= since )
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    *first = lo * idx->interval;
+
+    // first block b with suffix_min[b] > until; the range ends there
+    for ( lo = 0, hi = idx->nblocks; lo < hi; ) {
+        mid = lo + (hi - lo) / 2;
+        if ( idx->suffix_min[mid] > until )
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    *end = lo * idx->interval;
+
+    if ( *end > idx->nrecs )
+        *end = idx->nrecs;
+    if ( *first > *end )
+        *first = *end;
+}
+
+
+/*****************************************************************************
+  utmp_index_close( index )  frees the index
+ *****************************************************************************/
+void utmp_index_close( utmp_index *idx )
+{
+    if ( idx == NULL )
+        return;
+    free( idx->entries );
+    free( idx->prefix_max );
+    free( idx->suffix_min );
+    free( idx );
+}
+
+
+/*****************************************************************************
+  read_index( fd, header, index, nrecs )
+  reads the saved index into the index struct if its header agrees with the
+  one given and it covers no more than the nrecs records the file now has
+  returns: the number of complete blocks read, which is 0 if the saved index
+           is missing or of no use
+ *****************************************************************************/
+static long read_index( int fd, struct index_header *want, utmp_index *idx,
+                       long nrecs )
+{
+    struct index_header  hdr;
+    long                 kept;
+    size_t               size;
+
+    if ( pread( fd, &hdr, sizeof(hdr), 0 ) != sizeof(hdr)
+          || memcmp( hdr.magic, want->magic, sizeof(hdr.magic) ) != 0
+          || hdr.interval   != want->interval
+          || hdr.first_sec  != want->first_sec
+          || hdr.first_usec != want->first_usec
+          || hdr.nrecs > nrecs || hdr.nrecs < 0 )
+        return 0;
+
+    kept = hdr.nrecs / hdr.interval;
+    size = kept * sizeof(struct index_entry);
+    if ( (idx->entries = malloc( size + sizeof(struct index_entry) )) == NULL )
+        return 0;
+    if ( pread( fd, idx->entries, size, sizeof(hdr) ) != (ssize_t) size )
+        return 0;
+    want->nrecs  = hdr.nrecs;       // so the caller knows what is on disk
+    idx->nblocks = kept;
+    idx->nrecs   = kept * hdr.interval;
+    return kept;
+}
+
+
+/*****************************************************************************
+  extend_index( index, reader, kept )
+  adds entries for every block of the file from block kept to the end,
+  reading the records of those blocks with the reader
+  returns: 0 on success, -1 if out of memory
+ *****************************************************************************/
+static int extend_index( utmp_index *idx, utmp_reader *reader, long kept )
+{
+    utmp_record         *rec, *end;
+    struct index_entry  *e = NULL, *bigger;
+    long                 room = kept + 1;
+    long                 pos;
+    int                  count;
+
+    if ( utmp_reader_seek( reader, kept * (long) idx->interval ) == -1 )
+        return -1;
+    if ( (bigger = realloc( idx->entries, room * sizeof(*bigger) )) == NULL )
+        return -1;
+    idx->entries = bigger;
+    idx->nblocks = kept;
+    pos = idx->nrecs = kept * (long) idx->interval;
+
+    while ( (count = utmp_reader_next_batch( reader, &rec, BATCH_SIZE )) > 0 )
+        for ( end = rec + count; rec < end; rec++, pos++ ) {
+            if ( pos % idx->interval == 0 ) {
+                // start a new block
+                if ( idx->nblocks == room ) {
+                    room *= 2;
+                    bigger = realloc( idx->entries, room * sizeof(*bigger) );
+                    if ( bigger == NULL )
+                        return -1;
+                    idx->entries = bigger;
+                }
+                e = &idx->entries[idx->nblocks++];
+                e->offset  = pos * (int64_t) sizeof(utmp_record);
+                e->min_sec = e->max_sec = rec->ut_tv.tv_sec;
+            }
+            if ( rec->ut_tv.tv_sec < e->min_sec )
+                e->min_sec = rec->ut_tv.tv_sec;
+            if ( rec->ut_tv.tv_sec > e->max_sec )
+                e->max_sec = rec->ut_tv.tv_sec;
+        }
+    idx->nrecs = pos;
+    return 0;
+}
+
+
+/*****************************************************************************
+  write_index( fd, header, index, kept )
+  writes the entries from block kept onward, trims anything after them, and
+  then writes the header, so that a crash part way through leaves a header
+  that describes no more than what was written before
+  returns: 0 on success, -1 on a write error
+ *****************************************************************************/
+static int write_index( int fd, struct index_header *hdr, utmp_index *idx,
+                        long kept )
+{
+    size_t  size = ( idx->nblocks - kept ) * sizeof(struct index_entry);
+    off_t   where = sizeof(*hdr) + kept * sizeof(struct index_entry);
+
+    if ( pwrite( fd, &idx->entries[kept], size, where ) != (ssize_t) size )
+        return -1;
+    if ( ftruncate( fd, where + size ) == -1 )
+        return -1;
+    hdr->nrecs = idx->nrecs;
+    if ( pwrite( fd, hdr, sizeof(*hdr), 0 ) != sizeof(*hdr) )
+        return -1;
+    return 0;
+}
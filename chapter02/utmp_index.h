@@ -0,0 +1,81 @@
+/******************************************************************************
+  Title          : utmp_index.h
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : A sparse time index kept beside a wtmp file
+  Purpose        : Lets a program that wants records from a range of times
+                   start reading near the first of them instead of at the
+                   beginning of the file
+  Build with     : compile utmp_index.c and utmp_utils.c with the program
+
+******************************************************************************
+ * Copyright (C) 2020 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+******************************************************************************/
+
+#ifndef __UTMP_INDEX_H__
+#define __UTMP_INDEX_H__
+
+#include <time.h>
+
+/*
+   The index divides the wtmp file into blocks of a fixed number of records
+   and stores, for each block, its byte offset and the smallest and largest
+   ut_tv.tv_sec of the records in it. Nothing is assumed about the order of
+   the times: OLD_TIME/NEW_TIME pairs and other clock changes can put a
+   record earlier than the one before it, and the smallest and largest
+   times of each block are what make the index correct in spite of that.
+
+   The index is stored in a file named after the wtmp file with ".idx"
+   appended, unless another name is given. It is brought up to date each
+   time it is opened: records appended to the wtmp file since the last time
+   are added, and the index is rebuilt if the wtmp file has been replaced.
+*/
+typedef struct utmp_index utmp_index;
+
+#define UTMP_INDEX_INTERVAL  1024   /* default number of records per block */
+
+
+/*****************************************************************************
+ utmp_index_open( utmp_file, index_file, interval )
+ loads the index of utmp_file from index_file, or from utmp_file".idx" if
+ index_file is NULL, extends it to cover any records added to utmp_file
+ since it was written, and saves it again. If there is no index file, or it
+ does not match utmp_file, it is built from scratch with one entry for
+ every interval records; an interval of 0 means UTMP_INDEX_INTERVAL.
+ returns: the index on success
+          NULL if utmp_file cannot be read or is not a regular file, or if
+          the index file cannot be written
+ *****************************************************************************/
+utmp_index *utmp_index_open( const char *, const char *, int );
+
+/*****************************************************************************
+ utmp_index_range( index, since, until, first, end )
+ finds the records that might have times from since to until, inclusive.
+ Every record of the file with such a time has an index in [*first, *end);
+ records in that range with other times are still possible, so the caller
+ must check the time of each one.
+ *****************************************************************************/
+void utmp_index_range( utmp_index *, time_t, time_t, long *, long * );
+
+/*****************************************************************************
+ utmp_index_close( index )  frees the index
+ *****************************************************************************/
+void utmp_index_close( utmp_index * );
+
+#endif /* __UTMP_INDEX_H__ */
@@ -0,0 +1,344 @@
+/******************************************************************************
+  Title          : utmp_sessions.c
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Pairs login and logout records of a wtmp file into
+                   sessions, the way last(1) does
+  Purpose        : Turns a stream of wtmp records into a stream of sessions
+                   with their start and end times in a single pass
+  Build with     : gcc -c utmp_sessions.c
+
+  Notes          : The open sessions are kept in a dense array, and an
+                   open-addressing hash table with linear probing maps the
+                   (ut_line, ut_id) key of each one to its place in the
+                   array. The table holds only small integers, so probing
+                   it touches little memory. When a session closes, its
+                   slot is removed by shifting later entries of its probe
+                   run back (no tombstones are left behind), and the last
+                   entry of the array is moved into its place. Nothing
+                   grows with the length of the file.
+
+******************************************************************************
+ * Copyright (C) 2020 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+******************************************************************************/
+#include  <stdlib.h>
+#include  <string.h>
+#include  <stdint.h>
+#include  <utmp.h>
+#include "utmp_sessions.h"
+
+#define START_SLOTS   64        /* initial size of the hash table */
+
+/* the key of an open session: ut_line and ut_id, zero-padded */
+typedef struct {
+    char  line[UT_LINESIZE];
+    char  id[4];
+} session_key;
+
+typedef struct {
+    session_key  key;
+    uint32_t     hash;
+    char         user[UT_NAMESIZE];
+    char         host[UT_HOSTSIZE];
+    time_t       start;
+} open_session;
+
+struct session_pairer {
+    uint32_t         *slots;     // 0 if empty, else index into open + 1
+    size_t            nslots;    // a power of 2
+    open_session     *open;      // the open sessions
+    size_t            nopen;
+    size_t            room;      // number of entries open can hold
+    time_t            last_time; // time of the latest record seen
+    session_callback  callback;
+    void             *arg;
+};
+
+static void      make_key( session_key *, const struct utmp * );
+static uint32_t  hash_key( const session_key * );
+static long      find( session_pairer *, const session_key *, uint32_t, size_t * );
+static int       insert( session_pairer *, const struct utmp *, const session_key *,
+                         uint32_t );
+static void      close_session( session_pairer *, size_t, size_t, time_t, int );
+static void      close_all( session_pairer *, time_t, int );
+static void      report( session_pairer *, open_session *, time_t, int );
+static int       grow_table( session_pairer * );
+
+
+/*****************************************************************************
+  session_pairer_new( callback, arg )  creates an empty pairer
+ *****************************************************************************/
+session_pairer *session_pairer_new( session_callback callback, void *arg )
+{
+    session_pairer *p;
+
+    if ( (p = calloc( 1, sizeof(session_pairer) )) == NULL )
+        return NULL;
+    p->nslots   = START_SLOTS;
+    p->callback = callback;
+    p->arg      = arg;
+    if ( (p->slots = calloc( p->nslots, sizeof(uint32_t) )) == NULL ) {
+        free( p );
+        return NULL;
+    }
+    return p;
+}
+
+
+/*****************************************************************************
+  session_pairer_add( pairer, record )  see utmp_sessions.h
+ *****************************************************************************/
+int session_pairer_add( session_pairer *p, const struct utmp *rec )
+{
+    session_key  key;
+    uint32_t     h;
+    size_t       slot;
+    long         i;
+
+    p->last_time = rec->ut_tv.tv_sec;
+    switch ( rec->ut_type ) {
+    case USER_PROCESS:
+        make_key( &key, rec );
+        h = hash_key( &key );
+        // a second login on the same line and id ends the first one
+        if ( (i = find( p, &key, h, &slot )) >= 0 )
+            close_session( p, i, slot, rec->ut_tv.tv_sec, SESSION_GONE );
+        return insert( p, rec, &key, h );
+
+    case DEAD_PROCESS:
+        make_key( &key, rec );
+        h = hash_key( &key );
+        if ( (i = find( p, &key, h, &slot )) >= 0 )
+            close_session( p, i, slot, rec->ut_tv.tv_sec, SESSION_LOGOUT );
+        return 0;
+
+    case BOOT_TIME:
+        close_all( p, rec->ut_tv.tv_sec, SESSION_CRASH );
+        return 0;
+
+    case RUN_LVL:
+        if ( strncmp( rec->ut_user, "shutdown", sizeof(rec->ut_user) ) == 0 )
+            close_all( p, rec->ut_tv.tv_sec, SESSION_DOWN );
+        return 0;
+    }
+    return 0;
+}
+
+
+/*****************************************************************************
+  session_pairer_finish( pairer )  see utmp_sessions.h
+ *****************************************************************************/
+void session_pairer_finish( session_pairer *p )
+{
+    close_all( p, p->last_time, SESSION_OPEN );
+    free( p->slots );
+    free( p->open );
+    free( p );
+}
+
+
+/*****************************************************************************
+  make_key( key, record )
+  copies the record's ut_line and ut_id into key, padding both with zeros
+  after the first NUL, so that keys can be hashed and compared as bytes
+ *****************************************************************************/
+static void make_key( session_key *key, const struct utmp *rec )
+{
+    strncpy( key->line, rec->ut_line, sizeof(key->line) );
+    strncpy( key->id, rec->ut_id, sizeof(key->id) );
+}
+
+
+/*****************************************************************************
+  hash_key( key )  returns the FNV-1a hash of the bytes of the key
+ *****************************************************************************/
+static uint32_t hash_key( const session_key *key )
+{
+    const unsigned char *b = (const unsigned char *) key;
+    uint32_t             h = 2166136261u;
+    size_t               i;
+
+    for ( i = 0; i < sizeof(*key); i++ )
+        h = ( h ^ b[i] ) * 16777619u;
+    return h;
+}
+
+
+/*****************************************************************************
+  find( pairer, key, hash, slot )
+  returns: the index in the open array of the session with the given key,
+           with *slot set to the table slot that refers to it
+           -1 if no session with that key is open
+ *****************************************************************************/
+static long find( session_pairer *p, const session_key *key, uint32_t h,
+                  size_t *slot )
+{
+    size_t        mask = p->nslots - 1;
+    size_t        i;
+    open_session *s;
+
+    for ( i = h & mask; p->slots[i] != 0; i = (i + 1) & mask ) {
+        s = &p->open[p->slots[i] - 1];
+        if ( s->hash == h && memcmp( &s->key, key, sizeof(*key) ) == 0 ) {
+            *slot = i;
+            return p->slots[i] - 1;
+        }
+    }
+    return -1;
+}
+
+
+/*****************************************************************************
+  insert( pairer, record, key, hash )
+  opens a session for the login record, which must not already be open
+  returns: 0 on success, -1 if out of memory
+ *****************************************************************************/
+static int insert( session_pairer *p, const struct utmp *rec,
+                   const session_key *key, uint32_t h )
+{
+    open_session *s;
+    size_t        mask, i;
+
+    if ( p->nopen == p->room ) {
+        size_t        room = p->room ? p->room * 2 : START_SLOTS / 2;
+        open_session *bigger = realloc( p->open, room * sizeof(open_session) );
+
+        if ( bigger == NULL )
+            return -1;
+        p->open = bigger;
+        p->room = room;
+    }
+    // keep the table at most half full
+    if ( (p->nopen + 1) * 2 > p->nslots && grow_table( p ) == -1 )
+        return -1;
+
+    s = &p->open[p->nopen];
+    s->key   = *key;
+    s->hash  = h;
+    s->start = rec->ut_tv.tv_sec;
+    memcpy( s->user, rec->ut_user, sizeof(s->user) );
+    memcpy( s->host, rec->ut_host, sizeof(s->host) );
+
+    mask = p->nslots - 1;
+    for ( i = h & mask; p->slots[i] != 0; i = (i + 1) & mask )
+        ;
+    p->slots[i] = ++p->nopen;
+    return 0;
+}
+
+
+/*****************************************************************************
+  close_session( pairer, index, slot, end, how )
+  reports the session at the given index of the open array, which the table
+  slot refers to, and removes it from both
+ *****************************************************************************/
+static void close_session( session_pairer *p, size_t idx, size_t slot,
+                           time_t end, int how )
+{
+    size_t  mask = p->nslots - 1;
+    size_t  i = slot, j = slot, home;
+    size_t  last;
+
+    report( p, &p->open[idx], end, how );
+
+    // Remove the slot. Any entry later in the same probe run whose home
+    // slot is not between the hole and itself is moved back into the hole.
+    for ( ;; ) {
+        j = (j + 1) & mask;
+        if ( p->slots[j] == 0 )
+            break;
+        home = p->open[p->slots[j] - 1].hash & mask;
+        if ( ( i <= j ) ? ( home <= i || home > j ) : ( home <= i && home > j ) ) {
+            p->slots[i] = p->slots[j];
+            i = j;
+        }
+    }
+    p->slots[i] = 0;
+
+    // fill the hole in the array with its last entry
+    last = --p->nopen;
+    if ( idx != last ) {
+        find( p, &p->open[last].key, p->open[last].hash, &slot );
+        p->open[idx]  = p->open[last];
+        p->slots[slot] = idx + 1;
+    }
+}
+
+
+/*****************************************************************************
+  close_all( pairer, end, how )
+  reports every open session as ending at the given time and empties the
+  table, as when the system reboots
+ *****************************************************************************/
+static void close_all( session_pairer *p, time_t end, int how )
+{
+    size_t  i;
+
+    for ( i = 0; i < p->nopen; i++ )
+        report( p, &p->open[i], end, how );
+    p->nopen = 0;
+    memset( p->slots, 0, p->nslots * sizeof(uint32_t) );
+}
+
+
+/*****************************************************************************
+  report( pairer, session, end, how )  passes a finished session to the
+  pairer's callback
+ *****************************************************************************/
+static void report( session_pairer *p, open_session *s, time_t end, int how )
+{
+    utmp_session  out;
+
+    strncpy( out.user, s->user, UT_NAMESIZE );
+    strncpy( out.line, s->key.line, UT_LINESIZE );
+    strncpy( out.host, s->host, UT_HOSTSIZE );
+    out.user[UT_NAMESIZE] = out.line[UT_LINESIZE] = out.host[UT_HOSTSIZE] = '\0';
+    out.start    = s->start;
+    out.end      = end;
+    out.duration = end - s->start;
+    out.how      = how;
+    p->callback( &out, p->arg );
+}
+
+
+/*****************************************************************************
+  grow_table( pairer )
+  doubles the number of slots in the hash table and reinserts every open
+  session
+  returns: 0 on success, -1 if out of memory
+ *****************************************************************************/
+static int grow_table( session_pairer *p )
+{
+    size_t    nslots = p->nslots * 2;
+    size_t    mask = nslots - 1;
+    uint32_t *slots;
+    size_t    i, k;
+
+    if ( (slots = calloc( nslots, sizeof(uint32_t) )) == NULL )
+        return -1;
+    for ( k = 0; k < p->nopen; k++ ) {
+        for ( i = p->open[k].hash & mask; slots[i] != 0; i = (i + 1) & mask )
+            ;
+        slots[i] = k + 1;
+    }
+    free( p->slots );
+    p->slots  = slots;
+    p->nslots = nslots;
+    return 0;
+}
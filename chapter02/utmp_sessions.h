@@ -0,0 +1,99 @@
+/******************************************************************************
+  Title          : utmp_sessions.h
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Pairs login and logout records of a wtmp file into
+                   sessions, the way last(1) does
+  Purpose        : Turns a stream of wtmp records into a stream of sessions
+                   with their start and end times in a single pass
+  Build with     : compile utmp_sessions.c with the program
+
+******************************************************************************
+ * Copyright (C) 2020 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+******************************************************************************/
+
+#ifndef __UTMP_SESSIONS_H__
+#define __UTMP_SESSIONS_H__
+
+#include <time.h>
+#include <utmp.h>
+
+/*
+   How a session ended
+*/
+#define SESSION_LOGOUT   0    /* a DEAD_PROCESS record on the same line/id */
+#define SESSION_GONE     1    /* another login on the line/id came first   */
+#define SESSION_CRASH    2    /* the system booted again first             */
+#define SESSION_DOWN     3    /* the system was shut down first            */
+#define SESSION_OPEN     4    /* still open at the end of the file         */
+
+/*
+   One session. The strings are NUL-terminated copies of the fixed-width
+   fields of the login record. For an open session, end is the time of the
+   last record in the file and duration is measured up to it.
+*/
+typedef struct {
+    char    user[UT_NAMESIZE + 1];
+    char    line[UT_LINESIZE + 1];
+    char    host[UT_HOSTSIZE + 1];
+    time_t  start;
+    time_t  end;
+    long    duration;           /* end - start, in seconds */
+    int     how;                /* one of the SESSION_ values above */
+} utmp_session;
+
+/*
+   Called once for each session, in the order in which the sessions end
+*/
+typedef void (*session_callback)( const utmp_session *, void * );
+
+/*
+   A session_pairer holds the sessions that are open at the current point
+   in the file, in a hash table keyed on ut_line and ut_id. Its memory use
+   depends on how many sessions are open at once, not on the size of the
+   file.
+*/
+typedef struct session_pairer session_pairer;
+
+
+/*****************************************************************************
+ session_pairer_new( callback, arg )
+ returns: a new pairer that will call callback( session, arg ) for each
+          session it completes
+          NULL if out of memory
+ *****************************************************************************/
+session_pairer *session_pairer_new( session_callback, void * );
+
+/*****************************************************************************
+ session_pairer_add( pairer, record )
+ feeds the next wtmp record, in file order, to the pairer. USER_PROCESS
+ records open sessions; DEAD_PROCESS records close the session on the same
+ line and id; BOOT_TIME and shutdown RUN_LVL records close all of them.
+ returns: 0 on success, -1 if out of memory
+ *****************************************************************************/
+int session_pairer_add( session_pairer *, const struct utmp * );
+
+/*****************************************************************************
+ session_pairer_finish( pairer )
+ reports every session that is still open as SESSION_OPEN and frees the
+ pairer
+ *****************************************************************************/
+void session_pairer_finish( session_pairer * );
+
+#endif /* __UTMP_SESSIONS_H__ */
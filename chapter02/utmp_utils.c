@@ -26,36 +26,848 @@
 
 ******************************************************************************/
 #include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <errno.h>
 #include  <unistd.h>
 #include  <fcntl.h>
 #include  <sys/types.h>
+#include  <sys/stat.h>
+#include  <sys/mman.h>
+#include  <stddef.h>
+#include  <pthread.h>
+#include  <zlib.h>
 #include  <utmp.h>
+#include  <utmpx.h>
 #include "utils.h"
 #include "utmp_utils.h"
 
-#define NUM_RECORDS           20
 #define SIZE_OF_UTMP_RECORD   (sizeof(utmp_record))
-#define BUFSIZE               ( NUM_RECORDS * SIZE_OF_UTMP_RECORD )
+#define DEFAULT_BUFSIZE       ( 1024 * 1024 )   // bytes per read() by default
+#define BUFSIZE_ENV           "UTMP_BUFSIZE"    // overrides the default
+#define MAX_BUFSIZE           ( 256 * 1024 * 1024 )  // largest buffer used
+#define GZ_INBUF              ( 128 * 1024 )    // bytes per read() by zlib
+#define FIELD_SIZE(f)         (sizeof(((utmp_record *) 0)->f))
+#define UTMPX_SIZE(f)         (sizeof(((struct utmpx *) 0)->f))
 
-static char  utmpbuf[BUFSIZE];          // buffer of records
-static int   number_of_recs_in_buffer;  // records stored into the buffer
-static int   current_record;            // next rec to read
-static int   fd_utmp = -1;              // file descriptor for utmp file
+/* nonzero if member f is at the same place in a struct utmp and a utmpx */
+#define SAME_FIELD(f) \
+    ( offsetof( utmp_record, f ) == offsetof( struct utmpx, f ) && \
+      FIELD_SIZE(f) == UTMPX_SIZE(f) )
+
+/* nonzero if a struct utmp can be used as a struct utmpx; a constant */
+#define UTMPX_IS_UTMP \
+    ( sizeof(utmp_record) == sizeof(struct utmpx) && \
+      SAME_FIELD(ut_type) && SAME_FIELD(ut_pid) && SAME_FIELD(ut_line) && \
+      SAME_FIELD(ut_id) && SAME_FIELD(ut_user) && SAME_FIELD(ut_host) && \
+      SAME_FIELD(ut_exit) && SAME_FIELD(ut_session) && SAME_FIELD(ut_tv) && \
+      SAME_FIELD(ut_addr_v6) )
+
+/*
+   A read_feed reads a file ahead of the reader with a thread of its own,
+   into two buffers in turn. The reader walks one of them while the thread
+   fills the other, so reading the file, and decompressing it if it is
+   gzipped, overlaps whatever the caller does with the records. full[i] is
+   set by the thread when buf[i] holds len[i] bytes and cleared by the
+   reader when it is done with them; both wait on cond for the other to
+   change it.
+*/
+typedef struct {
+    gzFile           gz;                // the file, if it is compressed
+    int              fd;                // the file, if it is not
+    off_t            offset;            // where to read fd next, or -1 if
+                                        // it is not seekable
+    pthread_t        thread;
+    pthread_mutex_t  lock;
+    pthread_cond_t   cond;
+    size_t           bufsize;           // size of each buffer in bytes
+    char            *buf[2];
+    size_t           len[2];            // bytes in buf[i]
+    int              full[2];
+    int              in_use;            // buffer the reader is in, or -1
+    int              at_end;            // the reader has the last buffer
+    int              err;               // errno if the reading failed
+    int              stop;              // set by the reader to end the thread
+} read_feed;
+
+/* nonzero if the reader's file is gzip-compressed */
+#define COMPRESSED(rdr)   ( (rdr)->feed != NULL && (rdr)->feed->gz != NULL )
+
+/*
+   All of the state of one open utmp file. Nothing in here is shared between
+   readers, so different readers can be used concurrently by different
+   threads, and one thread can have any number of files open at once.
+*/
+struct utmp_reader {
+    int     fd;                         // file descriptor for utmp file
+    char   *map;                        // mapping of whole file, if mapped
+    size_t  map_len;                    // length of that mapping in bytes
+    char   *records;                    // map, or buf if not mapped
+    int     number_of_recs_in_buffer;   // records stored into the buffer
+    int     current_record;             // next rec to read
+    size_t  bufsize;                    // size of buf in bytes
+    char   *buf;                        // buffer of records
+    off_t   buf_offset;                 // file offset of buf[0]
+    off_t   buf_end;                    // file offset just past data in buf
+    unsigned int type_mask;             // ut_types to return, 1 bit each
+    off_t   limit;                      // offset where reading stops, or -1
+    read_feed *feed;                    // thread reading ahead, if any
+    struct utmpx utmpx;                 // last record converted to a utmpx,
+                                        // where the layouts differ
+};
+
+/* nonzero if the type of the record at p is one of those in mask */
+#define WANTED(p, mask) \
+    ( (unsigned) ((utmp_record *)(p))->ut_type < 32 && \
+      ( (mask) >> ((utmp_record *)(p))->ut_type & 1 ) )
+
+/* The reader behind open_utmp(), next_utmp() and close_utmp() */
+static utmp_reader *default_reader = NULL;
+
+/*
+   A columnar file starts with this header. Section i is column i for i less
+   than UTMP_NCOLUMNS; the three sections after those are the dictionaries
+   of ut_line, ut_user and ut_host, each an array of entries as wide as the
+   field. Every section starts on an 8-byte boundary, so that the arrays can
+   be used in place. All numbers are in the byte order of the writer.
+*/
+#define COLUMNS_MAGIC  "UTMPCOL1"
+#define NDICTS         3
+#define NSECTIONS      ( UTMP_NCOLUMNS + NDICTS )
+#define ALIGN8(n)      ( ((n) + 7) & ~(size_t) 7 )
+
+struct columns_header {
+    char     magic[8];
+    int32_t  nsections;
+    int32_t  record_size;       // sizeof(utmp_record) of the writer
+    int64_t  nrecs;
+    struct {
+        int64_t  offset;
+        int64_t  length;        // in bytes
+    } section[NSECTIONS];
+};
+
+struct utmp_columns {
+    char        *map;           // the whole file
+    size_t       map_len;
+    long         nrecs;
+    const char  *section[NSECTIONS];
+    uint32_t     dict_size[NDICTS];   // number of entries in each dictionary
+};
+
+/* size of an element of each column, in the order of the UTMP_COL_ values */
+static const size_t column_size[UTMP_NCOLUMNS] = {
+    sizeof(short), sizeof(int32_t), sizeof(uint32_t), FIELD_SIZE(ut_id),
+    sizeof(uint32_t), sizeof(uint32_t), sizeof(struct exit_status),
+    sizeof(int32_t), sizeof(int64_t), sizeof(int32_t), FIELD_SIZE(ut_addr_v6)
+};
+
+/* the dictionary-encoded columns, and the widths of their fields */
+static const int    dict_column[NDICTS] = { UTMP_COL_LINE, UTMP_COL_USER,
+                                            UTMP_COL_HOST };
+static const size_t dict_width[NDICTS]  = { FIELD_SIZE(ut_line),
+                                            FIELD_SIZE(ut_user),
+                                            FIELD_SIZE(ut_host) };
+
+
+static int    fill_utmp( utmp_reader * );
+static int    is_gzip( int, const char * );
+static int    open_feed( utmp_reader *, size_t, int );
+static size_t feed_read( read_feed *, char * );
+static void  *feed_producer( void * );
+static int    fill_feed( utmp_reader * );
+static void   close_feed( read_feed * );
+static int    skip_unwanted( utmp_reader * );
+static int    fill_utmp_backward( utmp_reader * );
+static void   map_utmp( utmp_reader *, int );
+static size_t choose_bufsize( int, size_t );
+static size_t parse_bufsize( const char * );
+static char  *dict_entries( intern_table *, size_t );
+static int    write_section( int, const void *, size_t, off_t );
+static int    copy_string( utmp_columns *, int, long, char * );
+
+/*****************************************************************************
+  utmp_reader_open( filename )  opens the given utmp file for reading
+  If the file is a regular file, it is mapped into memory and
+  utmp_reader_next() returns pointers directly into the mapping. Otherwise
+  (pipes, terminals, and other special files) records are read into the
+  reader's buffer.
+  returns: a new reader on success
+           NULL on error, with errno set by open() or malloc()
+*****************************************************************************/
+utmp_reader *utmp_reader_open( const char *file_utmp )
+{
+    return utmp_reader_open_flags( file_utmp, 0, 0 );
+}
+
+/*****************************************************************************
+  utmp_reader_open_flags( filename, flags, bufsize )
+  opens the given utmp file for reading, as utmp_reader_open() does, except
+  that the file is not mapped if flags contains UTMP_NOMAP, and that if
+  bufsize is not zero, it is used as the number of bytes to request in each
+  read() instead of the size chosen by choose_bufsize().
+  If flags contains UTMP_FROM_END, the reader starts out positioned after the
+  last whole record in the file, ready for utmp_reader_prev().
+  A gzip-compressed file, or any file with UTMP_PREFETCH unless it is to be
+  read from the end, is never mapped; it is read through a read_feed.
+  returns: a new reader on success
+           NULL on error, with errno set by open(), malloc(), lseek() or
+           pthread_create(). Opening a pipe or a compressed file with
+           UTMP_FROM_END fails with ESPIPE.
+*****************************************************************************/
+utmp_reader *utmp_reader_open_flags( const char *file_utmp, int flags,
+                                     size_t bufsize )
+{
+    utmp_reader *rdr;
+    int          compressed;
+
+    if ( (rdr = malloc( sizeof(utmp_reader) )) == NULL )
+        return NULL;
+    if ( (rdr->fd = open( file_utmp, O_RDONLY )) == -1 ) {
+        free( rdr );
+        return NULL;
+    }
+    rdr->map     = NULL;
+    rdr->map_len = 0;
+    rdr->buf     = NULL;
+    rdr->bufsize = 0;
+    rdr->buf_offset = 0;
+    rdr->buf_end    = 0;
+    rdr->type_mask  = UTMP_ALL_TYPES;
+    rdr->limit      = -1;
+    rdr->feed       = NULL;
+    rdr->current_record           = 0;
+    rdr->number_of_recs_in_buffer = 0;
+
+    compressed = is_gzip( rdr->fd, file_utmp );
+    if ( compressed && (flags & UTMP_FROM_END) ) {
+        errno = ESPIPE;
+        close( rdr->fd );
+        free( rdr );
+        return NULL;
+    }
+    if ( compressed || ( (flags & UTMP_PREFETCH) && ! (flags & UTMP_FROM_END) ) ) {
+        if ( open_feed( rdr, bufsize, compressed ) == -1 ) {
+            close( rdr->fd );
+            free( rdr );
+            return NULL;
+        }
+        return rdr;
+    }
+    if ( ! (flags & UTMP_NOMAP) )
+        map_utmp( rdr, flags );
+
+    if ( rdr->map != NULL ) {
+        if ( flags & UTMP_FROM_END )
+            rdr->current_record = rdr->number_of_recs_in_buffer;
+        return rdr;
+    }
+
+    if ( flags & UTMP_FROM_END ) {
+        // start with an empty buffer that ends at the last whole record
+        rdr->buf_end = lseek( rdr->fd, 0, SEEK_END );
+        if ( rdr->buf_end == -1 ) {
+            close( rdr->fd );
+            free( rdr );
+            return NULL;
+        }
+        rdr->buf_end   -= rdr->buf_end % SIZE_OF_UTMP_RECORD;
+        rdr->buf_offset = rdr->buf_end;
+        // so that reading forward from here starts on a record boundary
+        if ( lseek( rdr->fd, rdr->buf_end, SEEK_SET ) == -1 ) {
+            close( rdr->fd );
+            free( rdr );
+            return NULL;
+        }
+    }
+    else
+        // tell the kernel to read ahead aggressively; harmless if it can't
+        posix_fadvise( rdr->fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+
+    rdr->bufsize = choose_bufsize( rdr->fd, bufsize );
+    if ( (rdr->buf = malloc( rdr->bufsize )) == NULL ) {
+        close( rdr->fd );
+        free( rdr );
+        return NULL;
+    }
+    rdr->records = rdr->buf;
+    return rdr;
+}
+
+/*****************************************************************************
+  utmp_reader_next( reader )
+  returns: a pointer to the next utmp record from the reader's file and
+           advances to the next  record
+           NULL if no more records are in the file
+ *****************************************************************************/
+utmp_record *utmp_reader_next( utmp_reader *rdr )
+{
+    size_t  byte_position;
+
+    if ( rdr->type_mask != UTMP_ALL_TYPES ) {
+        if ( skip_unwanted( rdr ) == 0 )
+            return NULL_UTMP_RECORD_PTR;
+    }
+    else if ( rdr->current_record == rdr->number_of_recs_in_buffer )
+        // there are no unread records in the buffer
+        // need to fill the buffer
+        if ( fill_utmp( rdr ) == 0 )
+            // no utmp records left in the file
+            return NULL_UTMP_RECORD_PTR;
+
+    // There is at least one record in the buffer, so we can read it
+    byte_position = rdr->current_record * SIZE_OF_UTMP_RECORD;
+
+    // advance current_record pointer and return record pointer
+    rdr->current_record++;
+    return ( utmp_record *) &rdr->records[byte_position];
+}
+
+/*****************************************************************************
+  utmp_reader_next_batch( reader, first, max )
+  returns: the number of records, at most max, in the run of unread records
+           that starts at the reader's position, and sets *first to point to
+           the first of them; the reader advances past the whole run
+           0 if no more records are in the file
+  The run never crosses a buffer refill, so it may be shorter than max even
+  when more records remain. If the reader has a type mask, the run starts at
+  the next wanted record and ends before the first unwanted one after it.
+ *****************************************************************************/
+int utmp_reader_next_batch( utmp_reader *rdr, utmp_record **first, int max )
+{
+    int    count;
+    char  *p, *end;
+
+    if ( rdr->type_mask != UTMP_ALL_TYPES ) {
+        if ( skip_unwanted( rdr ) == 0 )
+            return 0;
+    }
+    else if ( rdr->current_record == rdr->number_of_recs_in_buffer )
+        if ( fill_utmp( rdr ) == 0 )
+            return 0;
+
+    count = rdr->number_of_recs_in_buffer - rdr->current_record;
+    if ( count > max )
+        count = max;
+    p = &rdr->records[rdr->current_record * SIZE_OF_UTMP_RECORD];
+    *first = ( utmp_record *) p;
+
+    if ( rdr->type_mask != UTMP_ALL_TYPES ) {
+        // the first record is wanted; stop the run at the next unwanted one
+        end = p + count * SIZE_OF_UTMP_RECORD;
+        for ( p += SIZE_OF_UTMP_RECORD; p < end; p += SIZE_OF_UTMP_RECORD )
+            if ( ! WANTED( p, rdr->type_mask ) )
+                break;
+        count = ( p - (char *) *first ) / SIZE_OF_UTMP_RECORD;
+    }
+    rdr->current_record += count;
+    return count;
+}
+
+/*****************************************************************************
+  utmp_reader_next_utmpx( reader )
+  returns: the next record as a struct utmpx, converted into the reader's
+           utmpx member unless the two structs have the same layout
+           NULL if no more records are in the file
+  UTMPX_IS_UTMP is a constant, so the compiler keeps only one of the two
+  ways.
+ *****************************************************************************/
+struct utmpx *utmp_reader_next_utmpx( utmp_reader *rdr )
+{
+    utmp_record   *rec;
+    struct utmpx  *x = &rdr->utmpx;
+
+    if ( (rec = utmp_reader_next( rdr )) == NULL_UTMP_RECORD_PTR )
+        return NULL;
+    if ( UTMPX_IS_UTMP )
+        return (struct utmpx *) rec;
+
+// copies as much of member f as both structs have room for
+#define COPY_FIELD(f) \
+    memcpy( &x->f, &rec->f, FIELD_SIZE(f) < UTMPX_SIZE(f) ? FIELD_SIZE(f) \
+                                                          : UTMPX_SIZE(f) )
+
+    memset( x, 0, sizeof(*x) );
+    x->ut_type       = rec->ut_type;
+    x->ut_pid        = rec->ut_pid;
+    x->ut_session    = rec->ut_session;
+    x->ut_tv.tv_sec  = rec->ut_tv.tv_sec;
+    x->ut_tv.tv_usec = rec->ut_tv.tv_usec;
+    COPY_FIELD(ut_line);
+    COPY_FIELD(ut_id);
+    COPY_FIELD(ut_user);
+    COPY_FIELD(ut_host);
+    COPY_FIELD(ut_exit);        // two shorts, whose names vary
+    COPY_FIELD(ut_addr_v6);
+    return x;
+#undef COPY_FIELD
+}
+
+/*****************************************************************************
+  utmp_reader_set_types( reader, mask )
+  makes the reader return only records whose ut_type is in mask, a bitwise
+  OR of UTMP_TYPE_MASK() values; UTMP_ALL_TYPES turns filtering off.
+ *****************************************************************************/
+void utmp_reader_set_types( utmp_reader *rdr, unsigned int mask )
+{
+    rdr->type_mask = mask;
+}
+
+/*****************************************************************************
+  utmp_reader_prev( reader )
+  returns: a pointer to the utmp record before the reader's current position
+           and moves the position back to that record, so that the next
+           call to utmp_reader_next() returns the same record again
+           NULL if the reader is at the start of the file, or if the file
+           cannot be read backward (it is not seekable)
+ *****************************************************************************/
+utmp_record *utmp_reader_prev( utmp_reader *rdr )
+{
+    char  *p;
+
+    do {
+        if ( rdr->current_record == 0 )
+            // the records before the buffer must be read in first
+            if ( fill_utmp_backward( rdr ) == 0 )
+                return NULL_UTMP_RECORD_PTR;
+
+        rdr->current_record--;
+        p = &rdr->records[rdr->current_record * SIZE_OF_UTMP_RECORD];
+    } while ( rdr->type_mask != UTMP_ALL_TYPES && ! WANTED( p, rdr->type_mask ) );
+    return ( utmp_record *) p;
+}
+
+/*****************************************************************************
+  utmp_reader_count( reader )
+  returns: the number of whole records in the reader's file
+           -1 if the file is not a regular file or is compressed, since
+           then it cannot be known without reading the whole file
+ *****************************************************************************/
+long utmp_reader_count( utmp_reader *rdr )
+{
+    struct stat  sb;
+
+    if ( COMPRESSED( rdr ) )
+        return -1;
+    if ( rdr->map != NULL )
+        return rdr->map_len / SIZE_OF_UTMP_RECORD;
+    if ( fstat( rdr->fd, &sb ) == -1 || ! S_ISREG( sb.st_mode ) )
+        return -1;
+    return sb.st_size / SIZE_OF_UTMP_RECORD;
+}
+
+/*****************************************************************************
+  utmp_reader_tell( reader )
+  returns: the index in the file of the record that utmp_reader_next() would
+           return next, counting from 0
+ *****************************************************************************/
+long utmp_reader_tell( utmp_reader *rdr )
+{
+    return rdr->buf_offset / SIZE_OF_UTMP_RECORD + rdr->current_record;
+}
+
+/*****************************************************************************
+  utmp_reader_seek( reader, index )
+  positions the reader so that utmp_reader_next() returns the record with
+  the given index next. If that record is already in the buffer, nothing is
+  read; otherwise the buffer is emptied and the file offset moved. A reader
+  with a read_feed gets a new one, which starts reading at the new offset.
+  returns: 0 on success
+           -1 if the file is not seekable or index is negative; a compressed
+           file counts as not seekable
+ *****************************************************************************/
+int utmp_reader_seek( utmp_reader *rdr, long index )
+{
+    off_t  offset = (off_t) index * SIZE_OF_UTMP_RECORD;
+    int    had_feed = rdr->feed != NULL;
+
+    if ( index < 0 )
+        return -1;
+    if ( rdr->map != NULL ) {
+        rdr->current_record = index < rdr->number_of_recs_in_buffer
+                              ? index : rdr->number_of_recs_in_buffer;
+        return 0;
+    }
+    if ( offset >= rdr->buf_offset
+         && offset <= rdr->buf_offset + (off_t) rdr->number_of_recs_in_buffer
+                                        * (off_t) SIZE_OF_UTMP_RECORD ) {
+        rdr->current_record = ( offset - rdr->buf_offset ) / SIZE_OF_UTMP_RECORD;
+        return 0;
+    }
+    if ( COMPRESSED( rdr ) || lseek( rdr->fd, 0, SEEK_CUR ) == -1 )
+        return -1;
+
+    // the feed's thread must be stopped before the file offset is moved
+    if ( had_feed ) {
+        close_feed( rdr->feed );
+        rdr->feed = NULL;
+    }
+    if ( lseek( rdr->fd, offset, SEEK_SET ) == -1 )
+        return -1;
+    rdr->buf_offset = rdr->buf_end = offset;
+    rdr->current_record = rdr->number_of_recs_in_buffer = 0;
+    if ( had_feed ) {
+        // start a new feed at the new offset
+        if ( open_feed( rdr, rdr->bufsize, 0 ) == -1 ) {
+            // go on reading without a thread
+            if ( (rdr->buf = malloc( rdr->bufsize )) == NULL )
+                die("Out of memory","");
+            rdr->records = rdr->buf;
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************
+  utmp_reader_set_limit( reader, index )
+  makes the record with the given index act as the end of the file for
+  reading forward: utmp_reader_next() and utmp_reader_next_batch() return
+  no record at or after it. An index of -1 removes the limit.
+  The records the buffer holds are counted again from its contents, so
+  that those an earlier, lower limit held back are returned.
+ *****************************************************************************/
+void utmp_reader_set_limit( utmp_reader *rdr, long index )
+{
+    off_t  last;
+
+    rdr->limit = index < 0 ? -1 : (off_t) index * (off_t) SIZE_OF_UTMP_RECORD;
+    if ( rdr->map != NULL )
+        rdr->number_of_recs_in_buffer = rdr->map_len / SIZE_OF_UTMP_RECORD;
+    else
+        rdr->number_of_recs_in_buffer = ( rdr->buf_end - rdr->buf_offset )
+                                        / (off_t) SIZE_OF_UTMP_RECORD;
+
+    // drop any records in the buffer that are past the limit
+    if ( rdr->limit >= 0 ) {
+        last = ( rdr->limit - rdr->buf_offset ) / (off_t) SIZE_OF_UTMP_RECORD;
+        if ( last < 0 )
+            last = 0;
+        if ( last < rdr->number_of_recs_in_buffer )
+            rdr->number_of_recs_in_buffer = last;
+    }
+    if ( rdr->current_record > rdr->number_of_recs_in_buffer )
+        rdr->current_record = rdr->number_of_recs_in_buffer;
+}
+
+/*****************************************************************************
+  utmp_reader_fd( reader )
+  returns: the file descriptor the reader is reading from
+ *****************************************************************************/
+int utmp_reader_fd( utmp_reader *rdr )
+{
+    return rdr->fd;
+}
+
+/*****************************************************************************
+  utmp_reader_bufsize( reader )
+  returns: the size in bytes of the reader's read buffer, as rounded by
+           choose_bufsize(), or 0 if the file is mapped
+ *****************************************************************************/
+size_t utmp_reader_bufsize( utmp_reader *rdr )
+{
+    return rdr->bufsize;
+}
+
+/*****************************************************************************
+  utmp_reader_close( reader )  closes the reader's file and frees the reader
+ *****************************************************************************/
+void utmp_reader_close( utmp_reader *rdr )
+{
+    if ( rdr == NULL )
+        return;
+    if ( rdr->map != NULL )
+        munmap( rdr->map, rdr->map_len );
+    if ( rdr->feed != NULL )
+        close_feed( rdr->feed );
+    close( rdr->fd );
+    free( rdr->buf );
+    free( rdr );
+}
+
+
+/*****************************************************************************
+  utmp_columns_write( utmp_file, columns_file )
+  reads the records of utmp_file in batches, appending each field to its
+  column in memory and interning each string field in the table that becomes
+  its dictionary, and then writes the columns and dictionaries out as
+  sections of columns_file".tmp" before renaming it to columns_file
+  returns: 0 on success
+           -1 on error, with errno set
+ *****************************************************************************/
+int utmp_columns_write( const char *utmp_file, const char *columns_file )
+{
+    utmp_reader           *reader;
+    utmp_record           *rec, *end;
+    char                  *cols[UTMP_NCOLUMNS + NDICTS] = { NULL };
+    intern_table          *dicts[NDICTS] = { NULL };
+    struct columns_header  hdr;
+    char                  *tmp = NULL, *bigger;
+    long                   n = 0, room = 0;
+    int                    count, c, d, id, fd = -1, saved_errno;
+    int64_t                sec;
+    off_t                  offset;
+
+    if ( (reader = utmp_reader_open( utmp_file )) == NULL )
+        return -1;
+    for ( d = 0; d < NDICTS; d++ )
+        if ( (dicts[d] = intern_new()) == NULL )
+            goto fail;
+
+    while ( (count = utmp_reader_next_batch( reader, &rec, 1024 )) > 0 )
+        for ( end = rec + count; rec < end; rec++, n++ ) {
+            if ( n == room ) {
+                room = room ? room * 2 : 4096;
+                for ( c = 0; c < UTMP_NCOLUMNS; c++ ) {
+                    if ( (bigger = realloc( cols[c], room * column_size[c] )) == NULL )
+                        goto fail;
+                    cols[c] = bigger;
+                }
+            }
+            sec = rec->ut_tv.tv_sec;
+            ((short *)   cols[UTMP_COL_TYPE])[n]    = rec->ut_type;
+            ((int32_t *) cols[UTMP_COL_PID])[n]     = rec->ut_pid;
+            ((int32_t *) cols[UTMP_COL_SESSION])[n] = rec->ut_session;
+            ((int64_t *) cols[UTMP_COL_SEC])[n]     = sec;
+            ((int32_t *) cols[UTMP_COL_USEC])[n]    = rec->ut_tv.tv_usec;
+            memcpy( cols[UTMP_COL_ID] + n * column_size[UTMP_COL_ID],
+                    rec->ut_id, column_size[UTMP_COL_ID] );
+            memcpy( cols[UTMP_COL_EXIT] + n * column_size[UTMP_COL_EXIT],
+                    &rec->ut_exit, column_size[UTMP_COL_EXIT] );
+            memcpy( cols[UTMP_COL_ADDR] + n * column_size[UTMP_COL_ADDR],
+                    rec->ut_addr_v6, column_size[UTMP_COL_ADDR] );
+            if ( (id = intern_field( dicts[0], rec->ut_line, dict_width[0] )) == -1 )
+                goto fail;
+            ((uint32_t *) cols[UTMP_COL_LINE])[n] = id;
+            if ( (id = intern_field( dicts[1], rec->ut_user, dict_width[1] )) == -1 )
+                goto fail;
+            ((uint32_t *) cols[UTMP_COL_USER])[n] = id;
+            if ( (id = intern_field( dicts[2], rec->ut_host, dict_width[2] )) == -1 )
+                goto fail;
+            ((uint32_t *) cols[UTMP_COL_HOST])[n] = id;
+        }
+    for ( d = 0; d < NDICTS; d++ )
+        if ( (cols[UTMP_NCOLUMNS + d] = dict_entries( dicts[d], dict_width[d] )) == NULL )
+            goto fail;
+
+    // lay out the sections one after another, following the header
+    memset( &hdr, 0, sizeof(hdr) );
+    memcpy( hdr.magic, COLUMNS_MAGIC, sizeof(hdr.magic) );
+    hdr.nsections   = NSECTIONS;
+    hdr.record_size = sizeof(utmp_record);
+    hdr.nrecs       = n;
+    offset = ALIGN8( sizeof(hdr) );
+    for ( c = 0; c < NSECTIONS; c++ ) {
+        hdr.section[c].offset = offset;
+        hdr.section[c].length = c < UTMP_NCOLUMNS
+                    ? n * column_size[c]
+                    : intern_count( dicts[c - UTMP_NCOLUMNS] )
+                      * dict_width[c - UTMP_NCOLUMNS];
+        offset += ALIGN8( hdr.section[c].length );
+    }
+
+    if ( (tmp = malloc( strlen(columns_file) + sizeof(".tmp") )) == NULL )
+        goto fail;
+    strcpy( tmp, columns_file );
+    strcat( tmp, ".tmp" );
+    if ( (fd = open( tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644 )) == -1 )
+        goto fail;
+    for ( c = 0; c < NSECTIONS; c++ )
+        if ( write_section( fd, cols[c], hdr.section[c].length,
+                            hdr.section[c].offset ) == -1 )
+            goto fail;
+    // the header goes last, and the file is trimmed to end after the sections
+    if ( write_section( fd, &hdr, sizeof(hdr), 0 ) == -1
+          || ftruncate( fd, offset ) == -1 )
+        goto fail;
+    c  = close( fd );
+    fd = -1;
+    if ( c == -1 || rename( tmp, columns_file ) == -1 )
+        goto fail;
+
+    errno = 0;
+fail:
+    saved_errno = errno;
+    if ( fd != -1 )
+        close( fd );
+    if ( saved_errno != 0 && tmp != NULL )
+        unlink( tmp );
+    free( tmp );
+    for ( c = 0; c < NSECTIONS; c++ )
+        free( cols[c] );
+    for ( d = 0; d < NDICTS; d++ )
+        intern_free( dicts[d] );
+    utmp_reader_close( reader );
+    errno = saved_errno;
+    return saved_errno == 0 ? 0 : -1;
+}
+
+/*****************************************************************************
+  utmp_columns_open( columns_file )
+  maps the file and checks that its header describes sections that lie
+  within it and have the sizes the record count calls for
+  returns: the open file on success
+           NULL on error, with errno set; EINVAL if it is not a columnar file
+ *****************************************************************************/
+utmp_columns *utmp_columns_open( const char *columns_file )
+{
+    utmp_columns          *cols;
+    struct columns_header *hdr;
+    struct stat            sb;
+    void                  *addr;
+    int                    fd, c;
+    int64_t                offset, length, want;
+
+    if ( (fd = open( columns_file, O_RDONLY )) == -1 )
+        return NULL;
+    if ( fstat( fd, &sb ) == -1 ) {
+        close( fd );
+        return NULL;
+    }
+    if ( sb.st_size < (off_t) sizeof(struct columns_header) ) {
+        close( fd );
+        errno = EINVAL;
+        return NULL;
+    }
+    addr = mmap( NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );               // the mapping stays valid without it
+    if ( addr == MAP_FAILED )
+        return NULL;
+    if ( (cols = malloc( sizeof(utmp_columns) )) == NULL ) {
+        munmap( addr, sb.st_size );
+        return NULL;
+    }
+    cols->map     = addr;
+    cols->map_len = sb.st_size;
+
+    hdr = addr;
+    if ( memcmp( hdr->magic, COLUMNS_MAGIC, sizeof(hdr->magic) ) != 0
+          || hdr->nsections != NSECTIONS
+          || hdr->record_size != sizeof(utmp_record)
+          || hdr->nrecs < 0 || hdr->nrecs > sb.st_size )
+        goto invalid;
+    cols->nrecs = hdr->nrecs;
+
+    for ( c = 0; c < NSECTIONS; c++ ) {
+        offset = hdr->section[c].offset;
+        length = hdr->section[c].length;
+        if ( offset < (int64_t) sizeof(*hdr) || offset % 8 != 0
+              || offset > sb.st_size || length < 0
+              || length > sb.st_size - offset )
+            goto invalid;
+        if ( c < UTMP_NCOLUMNS )
+            want = hdr->nrecs * (int64_t) column_size[c];
+        else {
+            want = length - length % (int64_t) dict_width[c - UTMP_NCOLUMNS];
+            cols->dict_size[c - UTMP_NCOLUMNS] = length / dict_width[c - UTMP_NCOLUMNS];
+        }
+        if ( length != want )
+            goto invalid;
+        cols->section[c] = cols->map + offset;
+    }
+    return cols;
+
+invalid:
+    utmp_columns_close( cols );
+    errno = EINVAL;
+    return NULL;
+}
+
+/*****************************************************************************
+  utmp_columns_count( columns )
+  returns: the number of records in the file
+ *****************************************************************************/
+long utmp_columns_count( utmp_columns *cols )
+{
+    return cols->nrecs;
+}
+
+/*****************************************************************************
+  utmp_columns_get( columns, column )
+  returns: a pointer to the packed array of the column
+           NULL if there is no such column
+ *****************************************************************************/
+const void *utmp_columns_get( utmp_columns *cols, int column )
+{
+    if ( column < 0 || column >= UTMP_NCOLUMNS )
+        return NULL;
+    return cols->section[column];
+}
+
+/*****************************************************************************
+  utmp_columns_string( columns, column, code )
+  returns: the dictionary entry with the given code for the column
+           NULL if the column has no dictionary or the code is not in it
+ *****************************************************************************/
+const char *utmp_columns_string( utmp_columns *cols, int column, uint32_t code )
+{
+    int  d;
+
+    for ( d = 0; d < NDICTS; d++ )
+        if ( dict_column[d] == column ) {
+            if ( code >= cols->dict_size[d] )
+                return NULL;
+            return cols->section[UTMP_NCOLUMNS + d] + code * dict_width[d];
+        }
+    return NULL;
+}
+
+/*****************************************************************************
+  utmp_columns_record( columns, index, record )
+  rebuilds one record from the columns. The bytes that follow the first NUL
+  in ut_line, ut_user and ut_host are zero, whatever they were in the
+  original file.
+  returns: 0 on success
+           -1 if the index is out of range or a code is not in its dictionary
+ *****************************************************************************/
+int utmp_columns_record( utmp_columns *cols, long i, utmp_record *rec )
+{
+    if ( i < 0 || i >= cols->nrecs )
+        return -1;
+    memset( rec, 0, sizeof(*rec) );
+    rec->ut_type          = ((const short *)   cols->section[UTMP_COL_TYPE])[i];
+    rec->ut_pid           = ((const int32_t *) cols->section[UTMP_COL_PID])[i];
+    rec->ut_session       = ((const int32_t *) cols->section[UTMP_COL_SESSION])[i];
+    rec->ut_tv.tv_sec     = ((const int64_t *) cols->section[UTMP_COL_SEC])[i];
+    rec->ut_tv.tv_usec    = ((const int32_t *) cols->section[UTMP_COL_USEC])[i];
+    memcpy( rec->ut_id, cols->section[UTMP_COL_ID] + i * column_size[UTMP_COL_ID],
+            sizeof(rec->ut_id) );
+    memcpy( &rec->ut_exit, cols->section[UTMP_COL_EXIT] + i * column_size[UTMP_COL_EXIT],
+            sizeof(rec->ut_exit) );
+    memcpy( rec->ut_addr_v6, cols->section[UTMP_COL_ADDR] + i * column_size[UTMP_COL_ADDR],
+            sizeof(rec->ut_addr_v6) );
+    if ( copy_string( cols, UTMP_COL_LINE, i, rec->ut_line ) == -1
+          || copy_string( cols, UTMP_COL_USER, i, rec->ut_user ) == -1
+          || copy_string( cols, UTMP_COL_HOST, i, rec->ut_host ) == -1 )
+        return -1;
+    return 0;
+}
+
+/*****************************************************************************
+  utmp_columns_close( columns )  unmaps the file and frees its state
+ *****************************************************************************/
+void utmp_columns_close( utmp_columns *cols )
+{
+    if ( cols == NULL )
+        return;
+    munmap( cols->map, cols->map_len );
+    free( cols );
+}
 
-int fill_utmp();
 
 /*****************************************************************************
   open_utmp( filename )  opens the given utmp file for buffered reading
+  This and the functions below it are wrappers around a single hidden
+  reader, kept for programs written before readers could be created.
   returns: a valid file descriptor on success
           -1 on error
   no error handling other than that
 *****************************************************************************/
 int open_utmp( char * file_utmp )
 {
-    fd_utmp = open( file_utmp, O_RDONLY );  // will return -1 on error
-    current_record   = 0;
-    number_of_recs_in_buffer = 0;
-    return fd_utmp;             // either a valid file descriptor or -1
+    close_utmp();
+    if ( (default_reader = utmp_reader_open( file_utmp )) == NULL )
+        return -1;
+    return default_reader->fd;   // a valid file descriptor
 }
 
 /*****************************************************************************
@@ -66,27 +878,38 @@ int open_utmp( char * file_utmp )
  *****************************************************************************/
 utmp_record * next_utmp()
 {
-    utmp_record * recordptr;
-    int           byte_position;
-
-    if ( -1 == fd_utmp )
+    if ( NULL == default_reader )
         // file was not opened correctly
         return NULL_UTMP_RECORD_PTR;
+    return utmp_reader_next( default_reader );
+}
 
-    if ( current_record == number_of_recs_in_buffer )
-        // there are no unread records in the buffer
-        // need to fill the buffer
-        if ( fill_utmp() == 0 )
-            // no utmp records left in the file
-            return NULL_UTMP_RECORD_PTR;
 
-    // There is at least one record in the buffer, so we can read it
-    byte_position = current_record * SIZE_OF_UTMP_RECORD;
-    recordptr = ( utmp_record *) &utmpbuf[byte_position];
+/*****************************************************************************
+  next_utmp_batch( first, max )
+  returns: the number of records in the next run of at most max records from
+           the opened file, with *first set to the first of them, as
+           utmp_reader_next_batch() does
+           0 if no more records are in the file
+ *****************************************************************************/
+int next_utmp_batch( utmp_record **first, int max )
+{
+    if ( NULL == default_reader )
+        return 0;
+    return utmp_reader_next_batch( default_reader, first, max );
+}
 
-    // advance current_record pointer and return record pointer
-    current_record++;
-    return recordptr;
+/*****************************************************************************
+  prev_utmp( )
+  returns: a pointer to the record before the current position in the opened
+           file, moving back to it, as utmp_reader_prev() does
+           NULL at the start of the file
+ *****************************************************************************/
+utmp_record * prev_utmp()
+{
+    if ( NULL == default_reader )
+        return NULL_UTMP_RECORD_PTR;
+    return utmp_reader_prev( default_reader );
 }
 
 
@@ -95,34 +918,557 @@ utmp_record * next_utmp()
  *****************************************************************************/
 void close_utmp()
 {
-    // if the file descriptor is a valid one, close the connection
-    if ( fd_utmp != -1 )
-        close( fd_utmp );
+    utmp_reader_close( default_reader );
+    default_reader = NULL;
 }
 
 /*****************************************************************************
-  reload_utmp( )
-  tries to read NUM_RECORDS records from the utmp file into the buffer.
+  map_utmp( reader, flags )
+  maps the reader's file into memory if it is a non-empty regular file.
+  On success the whole file is treated as one big buffer: the number of
+  records in the buffer is the number of whole records in the file, so
+  fill_utmp() is never asked for more. If the file cannot be mapped, the
+  buffered path is left in place.
+ *****************************************************************************/
+static void map_utmp( utmp_reader *rdr, int flags )
+{
+    struct stat  sb;
+    void        *addr;
+
+    if ( fstat( rdr->fd, &sb ) == -1 || ! S_ISREG( sb.st_mode ) )
+        return;
+    if ( sb.st_size < (off_t) SIZE_OF_UTMP_RECORD )
+        return;
+
+    addr = mmap( NULL, sb.st_size, PROT_READ, MAP_PRIVATE, rdr->fd, 0 );
+    if ( addr == MAP_FAILED )
+        return;
+    if ( ! (flags & UTMP_FROM_END) )
+        madvise( addr, sb.st_size, MADV_SEQUENTIAL );
+
+    rdr->map     = addr;
+    rdr->map_len = sb.st_size;
+    rdr->records = addr;
+    rdr->number_of_recs_in_buffer = sb.st_size / SIZE_OF_UTMP_RECORD;
+}
+
+/*****************************************************************************
+  choose_bufsize( fd, requested )
+  returns the size of the read buffer for the file open on fd.
+  If requested is zero, the size is taken from the UTMP_BUFSIZE environment
+  variable, which may end in k or m, or else, or if the variable does not
+  hold such a size, is DEFAULT_BUFSIZE. No size is taken above MAX_BUFSIZE.
+  It is then
+  rounded up to a multiple of both the record size, so that a full read()
+  ends on a record boundary and leaves nothing for fill_utmp() to carry
+  over, and the file's preferred I/O block size. A regular file smaller
+  than that gets a buffer just big enough to hold it.
+  An fd of -1 stands for data that does not come straight from a file, as
+  with a compressed file; the size is then only rounded to whole records.
+ *****************************************************************************/
+static size_t choose_bufsize( int fd, size_t requested )
+{
+    struct stat  sb;
+    size_t       size = requested;
+    size_t       unit = SIZE_OF_UTMP_RECORD;
+    size_t       blksize, a, b, t;
+    char        *env;
+
+    if ( 0 == size && (env = getenv( BUFSIZE_ENV )) != NULL )
+        size = parse_bufsize( env );
+    if ( 0 == size )
+        size = DEFAULT_BUFSIZE;
+    if ( size > MAX_BUFSIZE )
+        size = MAX_BUFSIZE;
+
+    if ( fstat( fd, &sb ) == 0 ) {
+        // unit = least common multiple of record size and block size
+        blksize = sb.st_blksize > 0 ? sb.st_blksize : 1;
+        for ( a = unit, b = blksize; b != 0; t = a % b, a = b, b = t )
+            ;
+        unit = unit / a * blksize;
+        if ( S_ISREG( sb.st_mode ) && sb.st_size > 0 && (size_t) sb.st_size < size )
+            size = sb.st_size;
+    }
+    if ( size < unit )
+        return ( size + SIZE_OF_UTMP_RECORD - 1 )
+                / SIZE_OF_UTMP_RECORD * SIZE_OF_UTMP_RECORD;
+    return ( size + unit - 1 ) / unit * unit;
+}
+
+/*****************************************************************************
+  parse_bufsize( str )
+  returns: the number of bytes in a size such as "65536", "64k" or "4m",
+           or MAX_BUFSIZE if it is more than that
+           0 if str is not such a size, as when it is empty or negative or
+           has anything else before or after the number
+ *****************************************************************************/
+static size_t parse_bufsize( const char *str )
+{
+    unsigned long  size;
+    size_t         unit = 1;
+    char          *end;
+
+    if ( *str < '0' || *str > '9' )
+        return 0;               // strtoul() would take a sign or spaces
+    errno = 0;
+    size = strtoul( str, &end, 10 );
+    if ( *end == 'k' || *end == 'K' )
+        unit = 1024;
+    else if ( *end == 'm' || *end == 'M' )
+        unit = 1024 * 1024;
+    if ( unit > 1 )
+        end++;
+    if ( *end != '\0' )
+        return 0;
+    if ( errno == ERANGE || size > MAX_BUFSIZE / unit )
+        return MAX_BUFSIZE;
+    return size * unit;
+}
+
+/*****************************************************************************
+  skip_unwanted( reader )
+  advances the reader to the next record whose type is in its type mask,
+  refilling the buffer as often as needed. The test is a single load of the
+  ut_type member of each record and a shift, so that unwanted records cost
+  very little even though each one is a few hundred bytes from the next.
+  returns: the number of records left in the buffer, counting the wanted one
+           0 if there are no more wanted records in the file
+ *****************************************************************************/
+static int skip_unwanted( utmp_reader *rdr )
+{
+    unsigned int  mask = rdr->type_mask;
+    char         *p, *end;
+
+    for ( ;; ) {
+        if ( rdr->current_record == rdr->number_of_recs_in_buffer )
+            if ( fill_utmp( rdr ) == 0 )
+                return 0;
+
+        p   = &rdr->records[rdr->current_record * SIZE_OF_UTMP_RECORD];
+        end = &rdr->records[rdr->number_of_recs_in_buffer * SIZE_OF_UTMP_RECORD];
+        while ( p < end && ! WANTED( p, mask ) )
+            p += SIZE_OF_UTMP_RECORD;
+
+        rdr->current_record = ( p - rdr->records ) / SIZE_OF_UTMP_RECORD;
+        if ( p < end )
+            return rdr->number_of_recs_in_buffer - rdr->current_record;
+    }
+}
+
+/*****************************************************************************
+  fill_utmp( reader )
+  tries to fill the buffer with records from the utmp file.
+  A read() can return any number of bytes, not just whole records: a pipe
+  gives what has been written to it so far, and a file being appended to
+  can end part way into a record. The bytes after the last whole record in
+  the buffer are therefore not thrown away but moved to its start, and the
+  next read() appends to them, so that the records stay aligned however the
+  data arrives. If the buffer does not yet hold a whole record, it reads
+  again, until it does or the file ends.
   if successful, it returns number of records actually read
   and sets current_record to the first record in the buffer
+  returns 0 at the end of the file or at the limit; any part of a record
+  left in the buffer is kept for the next call.
+ *****************************************************************************/
+static int fill_utmp( utmp_reader *rdr )
+{
+    ssize_t  bytes_read;
+    size_t   used, have, wanted;
+    long     n;
+
+    // a mapped file has all of its records in the "buffer" already
+    if ( rdr->map != NULL )
+        return 0;
+    if ( rdr->feed != NULL )
+        return fill_feed( rdr );
+
+    // The new buffer starts just after the last whole record of the old
+    // one; the bytes after it, if any, move to the front of the buffer.
+    used = (size_t) rdr->number_of_recs_in_buffer * SIZE_OF_UTMP_RECORD;
+    have = rdr->buf_end - rdr->buf_offset - used;
+    if ( have > 0 )
+        memmove( rdr->buf, rdr->buf + used, have );
+    rdr->buf_offset += used;
+    rdr->current_record = rdr->number_of_recs_in_buffer = 0;
+
+    // read into the rest of the buffer, but nothing past the limit, if
+    // there is one
+    while ( have < SIZE_OF_UTMP_RECORD ) {
+        wanted = rdr->bufsize - have;
+        if ( rdr->limit >= 0 && rdr->limit - rdr->buf_end < (off_t) wanted )
+            wanted = rdr->limit > rdr->buf_end ? rdr->limit - rdr->buf_end : 0;
+        if ( 0 == wanted )
+            break;
+        bytes_read = read( rdr->fd, rdr->buf + have, wanted );
+        if ( bytes_read < 0 && errno == EINTR )
+            continue;
+        if ( bytes_read < 0 ) {
+            die("Failed to read from utmp file","");
+        }
+        if ( 0 == bytes_read )
+            break;                          // the end of the file, for now
+        have         += bytes_read;
+        rdr->buf_end += bytes_read;
+    }
+
+    // Convert the bytecount into a number of records, none past the limit
+    n = have / SIZE_OF_UTMP_RECORD;
+    if ( rdr->limit >= 0 && rdr->buf_offset
+                            + (off_t) n * (off_t) SIZE_OF_UTMP_RECORD > rdr->limit )
+        n = rdr->limit > rdr->buf_offset
+            ? ( rdr->limit - rdr->buf_offset ) / SIZE_OF_UTMP_RECORD : 0;
+    rdr->number_of_recs_in_buffer = n;
+    return n;
+}
+
+/*****************************************************************************
+  fill_utmp_backward( reader )
+  tries to fill the buffer with the records that come just before the ones
+  now in it, reading one buffer's worth of records ending where the buffer
+  now starts. Because the buffer always starts on a record boundary and its
+  size is a multiple of the record size, each block read is record-aligned.
+  if successful, it returns number of records actually read and sets
+  current_record to just past the last record in the buffer. The file
+  offset is left at the end of the block so that fill_utmp() can carry on
+  forward from there.
+  returns 0 at the start of the file or if the file is not seekable.
+ *****************************************************************************/
+static int fill_utmp_backward( utmp_reader *rdr )
+{
+    off_t    end = rdr->buf_offset;
+    off_t    start;
+    ssize_t  bytes_read;
+    size_t   total = 0;
+
+    // a mapped file has all of its records in the "buffer" already, and one
+    // read through a read_feed is read only forward
+    if ( rdr->map != NULL || rdr->feed != NULL || end <= 0 )
+        return 0;
+
+    start = end > (off_t) rdr->bufsize ? end - (off_t) rdr->bufsize : 0;
+    if ( lseek( rdr->fd, start, SEEK_SET ) == -1 )
+        return 0;
+    while ( total < (size_t) (end - start) ) {
+        bytes_read = read( rdr->fd, rdr->buf + total, (end - start) - total );
+        if ( bytes_read < 0 )
+            die("Failed to read from utmp file","");
+        if ( bytes_read == 0 )
+            break;          // the file was truncated under us
+        total += bytes_read;
+    }
+
+    rdr->buf_offset = start;
+    rdr->buf_end    = start + total;
+    rdr->number_of_recs_in_buffer = total / SIZE_OF_UTMP_RECORD;
+    rdr->current_record = rdr->number_of_recs_in_buffer;
+    return rdr->number_of_recs_in_buffer;
+}
+
+/*****************************************************************************
+  is_gzip( fd, filename )
+  returns: nonzero if the file is gzip-compressed: a regular file is tested
+           for the gzip magic number, so that the name does not matter;
+           anything else, which cannot be read twice, by whether its name
+           ends in ".gz"
+ *****************************************************************************/
+static int is_gzip( int fd, const char *file_utmp )
+{
+    struct stat    sb;
+    unsigned char  magic[2];
+    size_t         len;
+
+    if ( fstat( fd, &sb ) == 0 && S_ISREG( sb.st_mode ) )
+        return pread( fd, magic, 2, 0 ) == 2 && magic[0] == 0x1f
+               && magic[1] == 0x8b;
+    len = strlen( file_utmp );
+    return len > 3 && strcmp( file_utmp + len - 3, ".gz" ) == 0;
+}
+
+/*****************************************************************************
+  open_feed( reader, bufsize, compressed )
+  sets the reader up to read its file through a read_feed, from the file's
+  current offset, and starts the thread that fills the feed's buffers. A
+  compressed file is read through zlib, which is given a duplicate of the
+  reader's descriptor, so that closing either does not close the other.
+  The buffers are of the size choose_bufsize() gives for bufsize; for a
+  compressed file it is not trimmed to the file, since the file is smaller
+  than its contents.
+  returns: 0 on success
+           -1 on error, with errno set
  *****************************************************************************/
-int fill_utmp()
+static int open_feed( utmp_reader *rdr, size_t bufsize, int compressed )
 {
-    int   bytes_read;
+    read_feed  *f;
+    int         fd, err;
 
-    // read NUM_RECORDS records from the utmp file into buffer
-    // bytes_read is the actual number of bytes read
-    bytes_read = read( fd_utmp , utmpbuf, BUFSIZE );
-    if ( bytes_read < 0 ) {
-        die("Failed to read from utmp file","");
+    if ( (f = calloc( 1, sizeof(read_feed) )) == NULL )
+        return -1;
+    f->fd      = rdr->fd;
+    f->offset  = compressed ? -1 : lseek( rdr->fd, 0, SEEK_CUR );
+    f->bufsize = choose_bufsize( compressed ? -1 : rdr->fd, bufsize );
+    f->in_use  = -1;
+    f->buf[0]  = malloc( f->bufsize );
+    f->buf[1]  = malloc( f->bufsize );
+    if ( f->buf[0] == NULL || f->buf[1] == NULL )
+        goto fail;
+    if ( compressed ) {
+        if ( (fd = dup( rdr->fd )) == -1 )
+            goto fail;
+        if ( (f->gz = gzdopen( fd, "rb" )) == NULL ) {
+            close( fd );
+            errno = ENOMEM;
+            goto fail;
+        }
+        gzbuffer( f->gz, GZ_INBUF );
+    }
+    else
+        posix_fadvise( rdr->fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+    pthread_mutex_init( &f->lock, NULL );
+    pthread_cond_init( &f->cond, NULL );
+    if ( (err = pthread_create( &f->thread, NULL, feed_producer, f )) != 0 ) {
+        pthread_mutex_destroy( &f->lock );
+        pthread_cond_destroy( &f->cond );
+        if ( f->gz != NULL )
+            gzclose( f->gz );
+        errno = err;
+        goto fail;
     }
 
-    // If we reach here, the read was successful
-    // Convert the bytecount into a number of records
-    number_of_recs_in_buffer = bytes_read/SIZE_OF_UTMP_RECORD;
+    rdr->feed    = f;
+    rdr->bufsize = f->bufsize;
+    rdr->records = f->buf[0];
+    return 0;
 
-    // reset current_record to start at the buffer start
-    current_record  = 0;
-    return number_of_recs_in_buffer;
+fail:
+    free( f->buf[0] );
+    free( f->buf[1] );
+    free( f );
+    return -1;
 }
 
+/*****************************************************************************
+  feed_read( feed, buf )
+  reads as much of the file as will fit into buf, going on after short
+  reads, as from a pipe, so that every buffer but the last is full and so
+  ends on a record boundary. A seekable file is read with pread() from the
+  feed's own offset, so that the thread never uses the descriptor's file
+  offset, which the reader may move.
+  returns: the number of bytes read, which is less than bufsize only at the
+           end of the file or on an error, when err is set as well
+ *****************************************************************************/
+static size_t feed_read( read_feed *f, char *buf )
+{
+    size_t   total = 0;
+    ssize_t  n;
+    int      errnum;
+
+    if ( f->gz != NULL ) {
+        // gzread() goes on by itself until it has all it was asked for
+        n = gzread( f->gz, buf, f->bufsize );
+        if ( n < 0 || (size_t) n < f->bufsize ) {
+            gzerror( f->gz, &errnum );
+            if ( n < 0 || errnum != Z_OK )
+                f->err = EIO;
+        }
+        return n < 0 ? 0 : n;
+    }
+    while ( total < f->bufsize ) {
+        if ( f->offset == -1 )
+            n = read( f->fd, buf + total, f->bufsize - total );
+        else if ( (n = pread( f->fd, buf + total, f->bufsize - total,
+                              f->offset )) > 0 )
+            f->offset += n;
+        if ( n == -1 && errno == EINTR )
+            continue;
+        if ( n == -1 )
+            f->err = errno;
+        if ( n <= 0 )
+            break;
+        total += n;
+    }
+    return total;
+}
+
+/*****************************************************************************
+  feed_producer( feed )
+  the thread that fills the feed's buffers in turn, waiting for each to be
+  given back before filling it again. A buffer that is not filled to the
+  top is the last, and the thread ends after it.
+ *****************************************************************************/
+static void *feed_producer( void *arg )
+{
+    read_feed  *f = arg;
+    int         i = 0;
+    size_t      n;
+
+    for ( ;; ) {
+        pthread_mutex_lock( &f->lock );
+        while ( f->full[i] && ! f->stop )
+            pthread_cond_wait( &f->cond, &f->lock );
+        if ( f->stop ) {
+            pthread_mutex_unlock( &f->lock );
+            break;
+        }
+        pthread_mutex_unlock( &f->lock );
+
+        n = feed_read( f, f->buf[i] );
+
+        pthread_mutex_lock( &f->lock );
+        f->len[i]  = n;
+        f->full[i] = 1;
+        pthread_cond_broadcast( &f->cond );
+        pthread_mutex_unlock( &f->lock );
+        if ( n < f->bufsize )
+            break;
+        i = 1 - i;
+    }
+    return NULL;
+}
+
+/*****************************************************************************
+  fill_feed( reader )
+  gives the buffer the reader has finished with back to the feed's thread
+  and makes the other one, once it is full, the reader's buffer. Records
+  of the buffer that the limit held back are not finished with: the buffer
+  is kept, and they are returned if the limit is raised or removed.
+  For a compressed file, buf_offset and buf_end count bytes of decompressed
+  data, so that utmp_reader_tell() and the limit work as they do for other
+  files.
+  returns: the number of records in the new buffer
+           0 at the end of the file or at the limit
+  If the reading ended in an error, the records before it are returned
+  first, and the program dies when the reader asks for more.
+ *****************************************************************************/
+static int fill_feed( utmp_reader *rdr )
+{
+    read_feed  *f = rdr->feed;
+    size_t      len;
+    off_t       n;
+
+    // step over the records returned; the rest of the buffer starts here
+    rdr->buf_offset += (off_t) rdr->number_of_recs_in_buffer * SIZE_OF_UTMP_RECORD;
+    rdr->records    += (size_t) rdr->number_of_recs_in_buffer * SIZE_OF_UTMP_RECORD;
+    rdr->current_record = rdr->number_of_recs_in_buffer = 0;
+
+    if ( rdr->buf_end - rdr->buf_offset < (off_t) SIZE_OF_UTMP_RECORD ) {
+        // the buffer is used up
+        if ( rdr->limit >= 0 && rdr->buf_offset >= rdr->limit )
+            return 0;
+        if ( ! f->at_end ) {
+            pthread_mutex_lock( &f->lock );
+            if ( f->in_use >= 0 ) {
+                f->full[f->in_use] = 0;
+                pthread_cond_broadcast( &f->cond );
+            }
+            f->in_use = f->in_use == 0 ? 1 : 0;
+            while ( ! f->full[f->in_use] )
+                pthread_cond_wait( &f->cond, &f->lock );
+            len = f->len[f->in_use];
+            pthread_mutex_unlock( &f->lock );
+
+            if ( len < f->bufsize )
+                f->at_end = 1;
+            rdr->records = f->buf[f->in_use];
+            rdr->buf_end = rdr->buf_offset + (off_t) len;
+        }
+        if ( f->at_end && rdr->buf_end - rdr->buf_offset
+                          < (off_t) SIZE_OF_UTMP_RECORD ) {
+            if ( f->err != 0 ) {
+                errno = f->err;
+                die( f->gz != NULL ? "Failed to decompress utmp file"
+                                   : "Failed to read from utmp file", "" );
+            }
+            return 0;
+        }
+    }
+
+    n = ( rdr->buf_end - rdr->buf_offset ) / (off_t) SIZE_OF_UTMP_RECORD;
+    if ( rdr->limit >= 0 && rdr->buf_offset + n * (off_t) SIZE_OF_UTMP_RECORD
+                            > rdr->limit )
+        n = rdr->limit > rdr->buf_offset
+            ? ( rdr->limit - rdr->buf_offset ) / (off_t) SIZE_OF_UTMP_RECORD : 0;
+    rdr->number_of_recs_in_buffer = n;
+    return n;
+}
+
+/*****************************************************************************
+  close_feed( feed )
+  stops the feed's thread, waits for it to finish, and frees the feed
+ *****************************************************************************/
+static void close_feed( read_feed *f )
+{
+    pthread_mutex_lock( &f->lock );
+    f->stop = 1;
+    pthread_cond_broadcast( &f->cond );
+    pthread_mutex_unlock( &f->lock );
+    pthread_join( f->thread, NULL );
+
+    if ( f->gz != NULL )
+        gzclose( f->gz );
+    pthread_mutex_destroy( &f->lock );
+    pthread_cond_destroy( &f->cond );
+    free( f->buf[0] );
+    free( f->buf[1] );
+    free( f );
+}
+
+/*****************************************************************************
+  dict_entries( table, width )
+  returns: the strings of the intern table in order of their ids, each
+           zero-padded to width bytes, in one array
+           NULL if out of memory
+ *****************************************************************************/
+static char *dict_entries( intern_table *table, size_t width )
+{
+    int    id, n = intern_count( table );
+    char  *entries;
+
+    if ( (entries = calloc( n + 1, width )) == NULL )
+        return NULL;
+    for ( id = 0; id < n; id++ )
+        strncpy( entries + id * width, intern_name( table, id ), width );
+    return entries;
+}
+
+/*****************************************************************************
+  write_section( fd, data, length, offset )
+  writes length bytes of data at the given offset of the file
+  returns: 0 on success, -1 on a write error
+ *****************************************************************************/
+static int write_section( int fd, const void *data, size_t length, off_t offset )
+{
+    const char  *p = data;
+    ssize_t      n;
+
+    while ( length > 0 ) {
+        if ( (n = pwrite( fd, p, length, offset )) == -1 ) {
+            if ( errno == EINTR )
+                continue;
+            return -1;
+        }
+        p      += n;
+        offset += n;
+        length -= n;
+    }
+    return 0;
+}
+
+/*****************************************************************************
+  copy_string( columns, column, index, field )
+  copies the dictionary value of the given record's column into the field
+  returns: 0 on success, -1 if the code is not in the dictionary
+ *****************************************************************************/
+static int copy_string( utmp_columns *cols, int column, long i, char *field )
+{
+    uint32_t     code = ((const uint32_t *) cols->section[column])[i];
+    const char  *value;
+    int          d;
+
+    if ( (value = utmp_columns_string( cols, column, code )) == NULL )
+        return -1;
+    for ( d = 0; dict_column[d] != column; d++ )
+        ;
+    memcpy( field, value, dict_width[d] );
+    return 0;
+}
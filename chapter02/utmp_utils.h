@@ -30,11 +30,281 @@
 #ifndef __UTMPLIB_H__
 #define __UTMPLIB_H__
 
+#include <sys/types.h>
+#include <stdint.h>
 #include <utmp.h>
+#include <utmpx.h>
 
 typedef struct utmp utmp_record;
 #define NULL_UTMP_RECORD_PTR  ((utmp_record *) NULL)
 
+/*
+   A utmp_reader holds everything needed to read one utmp file. Its contents
+   are private to utmp_utils.c. Each reader is independent of every other, so
+   a program may read several files at once, in the same thread or in
+   different threads, as long as no one reader is used by two threads at the
+   same time.
+*/
+typedef struct utmp_reader utmp_reader;
+
+
+/*****************************************************************************
+ utmp_reader_open( filename )  opens the given utmp file for reading
+ Regular files are mapped into memory, so that utmp_reader_next() can return
+ pointers into the mapping without copying; pipes and other special files
+ are read through a buffer. A gzip-compressed file, such as a rotated
+ wtmp.1.gz, is recognized by its contents (or, if it is not a regular file,
+ by a name ending in ".gz") and decompressed as it is read by a thread of
+ the reader's own, so that the records are the same as those of the
+ uncompressed file. Such a file can only be read forward: it cannot be
+ opened with UTMP_FROM_END, utmp_reader_prev() treats it as the start of the
+ file, utmp_reader_seek() fails outside the buffer, and utmp_reader_count()
+ returns -1.
+ returns: a new reader on success
+          NULL on error, with errno set
+*****************************************************************************/
+utmp_reader *utmp_reader_open( const char * );
+
+/*
+   Flags for utmp_reader_open_flags()
+*/
+#define UTMP_NOMAP     0x01     /* always read through a buffer */
+#define UTMP_FROM_END  0x02     /* start after the last record */
+#define UTMP_PREFETCH  0x04     /* read ahead in a thread of the reader's */
+
+/*****************************************************************************
+ utmp_reader_open_flags( filename, flags, bufsize )
+ opens the given utmp file for reading, like utmp_reader_open(), except that
+ the file is never mapped if flags contains UTMP_NOMAP, and that a non-zero
+ bufsize sets how many bytes are requested by each read() when the file is
+ not mapped. When bufsize is zero, the size comes from the UTMP_BUFSIZE
+ environment variable (e.g. "64k", "4m") if it is set to such a size, and
+ is 1 MB otherwise; no size is taken above 256 MB. It is then rounded to a
+ multiple of the record size and the file's block size, and trimmed for
+ files smaller than that. A read() that ends part way into a record, as one
+ from a pipe can, loses nothing: the part is kept and completed by the next
+ read().
+ With UTMP_FROM_END the reader starts after the last whole record, so that
+ utmp_reader_prev() returns the records in reverse order; the file must be
+ seekable.
+ With UTMP_PREFETCH the file is never mapped, and a thread started for the
+ reader reads the next buffer while the caller works through the one before
+ it, so that waiting for the disk overlaps the caller's own work. The reader
+ then has two buffers of bufsize bytes. It reads only forward:
+ utmp_reader_prev() treats the start of its buffer as the start of the file.
+ The flag is ignored with UTMP_FROM_END. A file read this way is read to
+ the end once; records appended after that are not seen.
+ returns: a new reader on success
+          NULL on error, with errno set
+*****************************************************************************/
+utmp_reader *utmp_reader_open_flags( const char *, int, size_t );
+
+/*****************************************************************************
+ utmp_reader_next( reader )
+ returns: a pointer to the next utmp record from the reader's file and
+          advances to the next  record
+          NULL if no more records are in the file
+ The record pointed to must be treated as read-only; it is valid only until
+ the reader is closed (mapped files) or the next call refills the buffer.
+ *****************************************************************************/
+utmp_record *utmp_reader_next( utmp_reader * );
+
+/*****************************************************************************
+ utmp_reader_next_batch( reader, first, max )
+ returns: the number of records, at most max, in the next run of records
+          that lie one after another in memory, with *first set to point to
+          the first of them; the reader advances past all of them
+          0 if no more records are in the file
+ This lets a caller loop over a block of records without a function call
+ per record. A run never spans a refill of the buffer, so it may hold fewer
+ than max records even when more remain. If a type mask has been set with
+ utmp_reader_set_types(), every record in the run is of a wanted type. The
+ same rules apply to the records as for utmp_reader_next().
+ *****************************************************************************/
+int utmp_reader_next_batch( utmp_reader *, utmp_record **, int );
+
+/*****************************************************************************
+ utmp_reader_next_utmpx( reader )
+ returns: a pointer to the next record from the reader's file, as a struct
+          utmpx, and advances to the next record
+          NULL if no more records are in the file
+ This lets programs written for the POSIX utmpx functions read any file,
+ not just the one named by utmpname(), without the locking and the call per
+ record of getutxent(). Where a struct utmpx has the same layout as a struct
+ utmp, as it has in glibc, the pointer is to the record itself, as with
+ utmp_reader_next(); elsewhere the record is converted into a struct utmpx
+ held by the reader, which the next call overwrites.
+ *****************************************************************************/
+struct utmpx *utmp_reader_next_utmpx( utmp_reader * );
+
+/*
+   Type masks for utmp_reader_set_types(). UTMP_TYPE_MASK(t) is the bit for
+   ut_type t, such as USER_PROCESS or DEAD_PROCESS.
+*/
+#define UTMP_TYPE_MASK(t)   ( 1u << (t) )
+#define UTMP_ALL_TYPES      ( ~0u )
+
+/*****************************************************************************
+ utmp_reader_set_types( reader, mask )
+ makes utmp_reader_next(), utmp_reader_next_batch() and utmp_reader_prev()
+ skip every record whose ut_type is not in mask, which is a bitwise OR of
+ UTMP_TYPE_MASK() values. The skipping is done while scanning the buffer,
+ so that unwanted records never reach the caller. A new reader has the
+ mask UTMP_ALL_TYPES, which returns every record.
+ *****************************************************************************/
+void utmp_reader_set_types( utmp_reader *, unsigned int );
+
+/*****************************************************************************
+ utmp_reader_prev( reader )
+ returns: a pointer to the record before the reader's current position, and
+          moves back to it; the next call to utmp_reader_next() returns the
+          same record again
+          NULL at the start of the file, or if the file is not seekable
+ Unmapped files are read backward in large record-aligned blocks. The same
+ rules apply to the record as for utmp_reader_next().
+ *****************************************************************************/
+utmp_record *utmp_reader_prev( utmp_reader * );
+
+/*****************************************************************************
+ utmp_reader_count( reader )
+ returns: the number of whole records in the reader's file
+          -1 if the file is not a regular file, or is compressed
+ *****************************************************************************/
+long utmp_reader_count( utmp_reader * );
+
+/*****************************************************************************
+ utmp_reader_tell( reader )
+ returns: the index, counting from 0, of the record that utmp_reader_next()
+          would return next
+ *****************************************************************************/
+long utmp_reader_tell( utmp_reader * );
+
+/*****************************************************************************
+ utmp_reader_seek( reader, index )
+ positions the reader so that utmp_reader_next() returns the record with
+ the given index next
+ returns: 0 on success
+          -1 if the file is not seekable or the index is negative
+ *****************************************************************************/
+int utmp_reader_seek( utmp_reader *, long );
+
+/*****************************************************************************
+ utmp_reader_set_limit( reader, index )
+ makes the record with the given index act as the end of the file when
+ reading forward, so that a reader can be confined to one part of a file,
+ as when several threads each take a range of records. -1 removes the limit.
+ *****************************************************************************/
+void utmp_reader_set_limit( utmp_reader *, long );
+
+/*****************************************************************************
+ utmp_reader_fd( reader )
+ returns: the file descriptor the reader is reading from
+ *****************************************************************************/
+int utmp_reader_fd( utmp_reader * );
+
+/*****************************************************************************
+ utmp_reader_bufsize( reader )
+ returns: the number of bytes the reader asks for in each read, which is
+          the requested size rounded up to whole records, and to whole
+          file system blocks if it is at least one of each, or 0 if the
+          file is mapped
+ *****************************************************************************/
+size_t utmp_reader_bufsize( utmp_reader * );
+
+/*****************************************************************************
+ utmp_reader_close( reader )  closes the file and frees the reader
+ *****************************************************************************/
+void utmp_reader_close( utmp_reader * );
+
+
+/*
+   A columnar file holds the records of a utmp file field by field instead of
+   record by record: all of the ut_type values in one packed array, then all
+   of the pids, and so on. ut_line, ut_user and ut_host are replaced by codes
+   into a dictionary of the distinct values of each, which are few. A scan
+   that needs only the type and time of each record reads 14 bytes of it
+   instead of all of it. The file is mapped, so columns that are not used
+   are never read from disk.
+
+   These are the columns, with the type of each element of their arrays.
+*/
+#define UTMP_COL_TYPE      0    /* short:        ut_type              */
+#define UTMP_COL_PID       1    /* int32_t:      ut_pid               */
+#define UTMP_COL_LINE      2    /* uint32_t:     code of ut_line      */
+#define UTMP_COL_ID        3    /* char[4]:      ut_id                */
+#define UTMP_COL_USER      4    /* uint32_t:     code of ut_user      */
+#define UTMP_COL_HOST      5    /* uint32_t:     code of ut_host      */
+#define UTMP_COL_EXIT      6    /* struct exit_status: ut_exit        */
+#define UTMP_COL_SESSION   7    /* int32_t:      ut_session           */
+#define UTMP_COL_SEC       8    /* int64_t:      ut_tv.tv_sec         */
+#define UTMP_COL_USEC      9    /* int32_t:      ut_tv.tv_usec        */
+#define UTMP_COL_ADDR     10    /* int32_t[4]:   ut_addr_v6           */
+#define UTMP_NCOLUMNS     11
+
+typedef struct utmp_columns utmp_columns;
+
+/*****************************************************************************
+ utmp_columns_write( utmp_file, columns_file )
+ reads every record of utmp_file and writes them to columns_file in columnar
+ form. The file is written under a temporary name and renamed when it is
+ complete.
+ returns: 0 on success
+          -1 on error, with errno set
+ *****************************************************************************/
+int utmp_columns_write( const char *, const char * );
+
+/*****************************************************************************
+ utmp_columns_open( columns_file )  maps a file written by
+ utmp_columns_write() for reading
+ returns: the open file on success
+          NULL on error, with errno set; EINVAL if it is not a columnar file
+ *****************************************************************************/
+utmp_columns *utmp_columns_open( const char * );
+
+/*****************************************************************************
+ utmp_columns_count( columns )
+ returns: the number of records in the file
+ *****************************************************************************/
+long utmp_columns_count( utmp_columns * );
+
+/*****************************************************************************
+ utmp_columns_get( columns, column )
+ returns: a pointer to the packed array of the given UTMP_COL_ column, with
+          one element per record, of the type listed above
+          NULL if there is no such column
+ The array is read-only and is valid until the file is closed.
+ *****************************************************************************/
+const void *utmp_columns_get( utmp_columns *, int );
+
+/*****************************************************************************
+ utmp_columns_string( columns, column, code )
+ returns: the value with the given code in the dictionary of UTMP_COL_LINE,
+          UTMP_COL_USER or UTMP_COL_HOST. Like the utmp field it came from,
+          it has the field's width and is NUL-terminated only if shorter.
+          NULL if the column has no dictionary or the code is not in it
+ *****************************************************************************/
+const char *utmp_columns_string( utmp_columns *, int, uint32_t );
+
+/*****************************************************************************
+ utmp_columns_record( columns, index, record )
+ rebuilds the record with the given index into *record
+ returns: 0 on success
+          -1 if the index is out of range or the file is corrupt
+ *****************************************************************************/
+int utmp_columns_record( utmp_columns *, long, utmp_record * );
+
+/*****************************************************************************
+ utmp_columns_close( columns )  unmaps the file and frees its state
+ *****************************************************************************/
+void utmp_columns_close( utmp_columns * );
+
+
+/*
+   The functions below read through one hidden reader. They are wrappers
+   around the functions above and only one file can be open through them
+   at a time.
+*/
+
 
 /*****************************************************************************
  open_utmp( filename )  opens the given utmp file for buffered reading
@@ -50,11 +320,28 @@ int open_utmp( char * );
  returns: a pointer to the next utmp record from the opened file and advances
          to the next  record
          NULL if no more records are in the file
+ The same rules apply to the record as for utmp_reader_next().
  *****************************************************************************/
 utmp_record *next_utmp();
 
 /*****************************************************************************
- closet_utmp( )   closes the utmp file and frees the file descriptor
+ next_utmp_batch( first, max )
+ returns: the number of records in the next run of at most max records from
+         the opened file, with *first set to the first of them
+         0 if no more records are in the file
+ *****************************************************************************/
+int next_utmp_batch( utmp_record **, int );
+
+/*****************************************************************************
+ prev_utmp( )
+ returns: a pointer to the record before the current position in the opened
+         file, moving back to it
+         NULL at the start of the file
+ *****************************************************************************/
+utmp_record *prev_utmp();
+
+/*****************************************************************************
+ close_utmp( )   closes the utmp file and frees the file descriptor
  *****************************************************************************/
 void close_utmp();
 
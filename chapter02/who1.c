@@ -76,21 +76,23 @@ int main(int argc, char *argv[])
 /*****************************************************************************
   show info()
   displays contents of the utmp struct in human readable form
-  The sizes used in the printf below are not guaranteed to work on all systems.
+  The field widths used below are not guaranteed to work on all systems.
   The ut_time member may be 32 or 64 bits.
  *****************************************************************************/
 void show_info( struct utmp *utbufp )
 {
-    printf("%-8.8s", utbufp->ut_name);    /* the logname    */
-    printf(" ");                          /* a space    */
-    printf("%-8.8s", utbufp->ut_line);    /* the tty    */
-    printf(" ");                          /* a space    */
-    printf("%10ld", utbufp->ut_time);     /* login time    */
-    printf(" ");                          /* a space    */
+    put_field(utbufp->ut_name, sizeof(utbufp->ut_name), 8); /* the logname */
+    put_char(' ');                        /* a space    */
+    put_field(utbufp->ut_line, sizeof(utbufp->ut_line), 8); /* the tty     */
+    put_char(' ');                        /* a space    */
+    put_long(utbufp->ut_time, 10);        /* login time    */
+    put_char(' ');                        /* a space    */
 #ifdef    SHOWHOST
-    printf("(%s)", utbufp->ut_host);      /* the host    */
+    put_char('(');                        /* the host    */
+    put_field(utbufp->ut_host, sizeof(utbufp->ut_host), 0);
+    put_char(')');
 #endif
-    printf("\n");                         /* newline    */
+    put_char('\n');                       /* newline    */
 
     return ;
 }
@@ -82,7 +82,7 @@ int main(int argc, char* argv[])
 /*****************************************************************************
   show info()
   displays contents of the utmp struct in human readable form
-  The sizes used in the printf below are not guaranteed to work on all systems.
+  The field widths used below are not guaranteed to work on all systems.
   The ut_time member may be 32 or 64 bits.
   If the type of entry is not USER_PROCESS, it skips the record
  *****************************************************************************/
@@ -91,16 +91,19 @@ void show_info( struct utmp *utbufp )
     if ( utbufp->ut_type != USER_PROCESS )
             return;
 
-    printf("%-8.8s", utbufp->ut_name);      /* the logname  */
-    printf(" ");                            /* a space      */
-    printf("%-12.12s", utbufp->ut_line);    /* the tty      */
-    printf(" ");                            /* a space      */
-    show_time( utbufp->ut_time );           /* display time */
+    put_field(utbufp->ut_name, sizeof(utbufp->ut_name), 8);  /* the logname */
+    put_char(' ');                          /* a space      */
+    put_field(utbufp->ut_line, sizeof(utbufp->ut_line), 12); /* the tty     */
+    put_char(' ');                          /* a space      */
+    put_time( utbufp->ut_time );            /* display time */
 #ifdef SHOWHOST
-    if ( utbufp->ut_host[0] != '\0' )
-        printf(" (%s)", utbufp->ut_host);   /* the host    */
+    if ( utbufp->ut_host[0] != '\0' ) {    /* the host     */
+        put_str(" (");
+        put_field(utbufp->ut_host, sizeof(utbufp->ut_host), 0);
+        put_char(')');
+    }
 #endif
-    printf("\n");                           /* newline      */
+    put_char('\n');                         /* newline      */
 }
 
 
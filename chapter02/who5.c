@@ -4,15 +4,25 @@
   Created on     : February  1, 2010
   Description    : Improves on who2.c by introducing buffered reads of utmp file
   Purpose        : To demonstrate how to do user controlled buffering
-  Usage          : who5
+  Usage          : who5 [file]
+                   shows the logins in the given utmp-format file, which
+                   may be gzipped, or else in the utmp file
 
   Build with     : gcc -o who5 who5.c utmp_utils.c -DSHOWHOST -I../include \
-                   -L../lib -lutils
+                   -L../lib -lutils -lz -lpthread
 
   Notes          : This program uses the functions in the file utmp_utils.c.
                    That file implements the buffering of the utmp file records.
-                   This main program uses calls to open_utmp(), next_utmp(),
-                   and close_utmp() defined there.
+                   This main program uses calls to utmp_reader_open(),
+                   utmp_reader_next_batch(), and utmp_reader_close() defined
+                   there. When the utmp file is a regular file,
+                   utmp_reader_open() maps it into memory and
+                   utmp_reader_next_batch() hands back whole runs of records
+                   without copying them. The reader is told to return only
+                   USER_PROCESS records, so the others are skipped as the
+                   buffer is scanned instead of being returned and ignored.
+                   A gzipped file is decompressed by the reader as it is
+                   read, so an archived wtmp.1.gz can be given as it is.
 
 ******************************************************************************
  * Copyright (C) 2020 - Stewart Weiss
@@ -44,12 +54,20 @@
 
 
 
+#define BATCH_SIZE  1024    /* most records to take from the reader at once */
+
 /*****************************************************************************
   show info( struct utmp* )
   displays contents of the utmp struct in human readable form
  *****************************************************************************/
 void show_info(utmp_record *);
 
+/*****************************************************************************
+  show batch( struct utmp*, int )
+  displays the login records in a run of consecutive utmp structs
+ *****************************************************************************/
+void show_batch(utmp_record *, int);
+
 
 /*****************************************************************************
                                Main Program
@@ -57,41 +75,59 @@ void show_info(utmp_record *);
 int main(int argc, char* argv[])
 {
 
-    utmp_record	*utbufp;        // points to a utmp record
+    utmp_reader *reader;        // reads the utmp file
+    utmp_record	*utbufp;        // points to first record of a batch
+    int          count;         // number of records in the batch
+    char        *file = UTMP_FILE;
 
-    if ( open_utmp( UTMP_FILE ) == -1 ){
-    	perror(UTMP_FILE);
+    if ( argc > 1 )
+        file = argv[1];
+    if ( ( reader = utmp_reader_open( file ) ) == NULL ){
+    	perror(file);
     	exit(1);
     }
-    while ( ( utbufp = next_utmp() ) != NULL_UTMP_RECORD_PTR  )
-    	show_info( utbufp );
+    utmp_reader_set_types( reader, UTMP_TYPE_MASK( USER_PROCESS ) );
+    while ( ( count = utmp_reader_next_batch( reader, &utbufp, BATCH_SIZE ) ) > 0 )
+    	show_batch( utbufp, count );
 
-    close_utmp( );
+    utmp_reader_close( reader );
     return 0;
 }
 
+/*****************************************************************************
+  show batch()
+  displays each of the count records starting at utbufp. The reader only
+  returns USER_PROCESS records, so there is nothing to skip here.
+ *****************************************************************************/
+void show_batch( utmp_record *utbufp, int count )
+{
+    utmp_record *end = utbufp + count;
+
+    for ( ; utbufp < end; utbufp++ )
+        show_info( utbufp );
+}
+
 /*****************************************************************************
   show info()
   displays contents of the utmp struct in human readable form
-  The sizes used in the printf below are not guaranteed to work on all systems.
+  The field widths used below are not guaranteed to work on all systems.
   The ut_time member may be 32 or 64 bits.
-  If the type of entry is not USER_PROCESS, it skips the record
  *****************************************************************************/
 void show_info( struct utmp *utbufp )
 {
-    if ( utbufp->ut_type != USER_PROCESS )
-            return;
-
-    printf("%-8.8s", utbufp->ut_name);      /* the logname  */
-    printf(" ");                            /* a space      */
-    printf("%-12.12s", utbufp->ut_line);    /* the tty      */
-    printf(" ");                            /* a space      */
-    show_time( utbufp->ut_time );           /* display time */
+    put_field(utbufp->ut_name, sizeof(utbufp->ut_name), 8);  /* the logname */
+    put_char(' ');                          /* a space      */
+    put_field(utbufp->ut_line, sizeof(utbufp->ut_line), 12); /* the tty     */
+    put_char(' ');                          /* a space      */
+    put_time( utbufp->ut_time );            /* display time */
 #ifdef SHOWHOST
-    if ( utbufp->ut_host[0] != '\0' )
-        printf(" (%s)", utbufp->ut_host);   /* the host    */
+    if ( utbufp->ut_host[0] != '\0' ) {    /* the host     */
+        put_str(" (");
+        put_field(utbufp->ut_host, sizeof(utbufp->ut_host), 0);
+        put_char(')');
+    }
 #endif
-    printf("\n");                           /* newline      */
+    put_char('\n');                         /* newline      */
 }
 
 
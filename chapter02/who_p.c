@@ -3,17 +3,25 @@
   Author         : Stewart Weiss
   Created on     : February  13, 2011
   Description    : Display records from wtmp or utmp file
-  Purpose        : Demonstrates how to process utmp structures
-                   using the POSIX.1 setutxent(), getutxent(), and endutxent()
-                   functions.
-  Usage          : who_p [wtmp]
+  Purpose        : Demonstrates how to process POSIX.1 utmpx structures
+  Usage          : who_p [wtmp | file]
                    if wtmp argument supplied, it shows the contents of
-                   wtmp file, otherwise it shows those of the utmp file
+                   wtmp file; if another argument is supplied, it shows
+                   the contents of that file; otherwise it shows those of
+                   the utmp file
   Remarks        :
                   - displays logins if utmp, all user_process records if wtmp
                   - suppresses empty records
                   - formats time nicely
-  Build with     : gcc -o who_p who_p.c -I../include -L../lib -lutils
+  Build with     : gcc -o who_p who_p.c utmp_utils.c -I../include \
+                   -L../lib -lutils -lz -lpthread
+  Notes          : This used to read the file with setutxent(), getutxent()
+                   and endutxent(), which can only read the file named by
+                   utmpname(), and which lock the file and make several
+                   system calls for every record. It now reads the records
+                   as struct utmpx with utmp_reader_next_utmpx() from
+                   utmp_utils.c, which maps the file, and asks the reader to
+                   skip all but USER_PROCESS records, the only ones shown.
 
 ******************************************************************************
  * Copyright (C) 2020 - Stewart Weiss
@@ -56,6 +64,7 @@
 #endif
 #include <utmpx.h>
 #include <fcntl.h>
+#include "utmp_utils.h"
 #include "utils.h"   // needed for the show_time() function
 
 
@@ -73,18 +82,24 @@ void show_info(struct utmpx *);
 int main(int argc, char* argv[])
 {
     struct utmpx  *utbufp;
+    utmp_reader   *reader;
+    char          *file = _PATH_UTMP;
 
     if ( (argc > 1) && (strcmp(argv[1],"wtmp") == 0) )
-        utmpname(_PATH_WTMP);
-    else
-        utmpname(_PATH_UTMP);
+        file = _PATH_WTMP;
+    else if ( argc > 1 )
+        file = argv[1];
 
-    setutxent();
+    if ( (reader = utmp_reader_open(file)) == NULL ) {
+        perror(file);
+        exit(1);
+    }
+    utmp_reader_set_types(reader, UTMP_TYPE_MASK(USER_PROCESS));
 
-    while( (utbufp = getutxent()) != NULL )
+    while( (utbufp = utmp_reader_next_utmpx(reader)) != NULL )
         show_info( utbufp );
 
-    endutxent();
+    utmp_reader_close(reader);
     return 0;
 }
 
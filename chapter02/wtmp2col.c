@@ -0,0 +1,59 @@
+/******************************************************************************
+  Title          : wtmp2col.c
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Converts a wtmp file into a columnar file
+  Purpose        : To convert a wtmp archive once so that programs that look
+                   at only a few fields of each record can read the columnar
+                   file with utmp_columns_open() instead
+  Usage          : wtmp2col [wtmp-file] columns-file
+                   where wtmp-file defaults to the system wtmp file
+  Build with     : gcc -o wtmp2col wtmp2col.c utmp_utils.c -I../include \
+                   -L../lib -lutils -lz -lpthread
+
+******************************************************************************
+ * Copyright (C) 2020 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <utmp.h>
+#include "utmp_utils.h"
+#include "utils.h"
+
+
+/*****************************************************************************
+                               Main Program
+*****************************************************************************/
+int main(int argc, char* argv[])
+{
+    char  *wtmp_file = WTMP_FILE;
+    char  *columns_file;
+
+    if ( argc < 2 || argc > 3 ) {
+        fprintf(stderr, "usage: %s [wtmp-file] columns-file\n", argv[0]);
+        exit(1);
+    }
+    if ( argc == 3 )
+        wtmp_file = argv[1];
+    columns_file = argv[argc - 1];
+
+    if ( utmp_columns_write( wtmp_file, columns_file ) == -1 )
+        die( "Cannot convert ", wtmp_file );
+    return 0;
+}
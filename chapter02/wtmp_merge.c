@@ -0,0 +1,273 @@
+/******************************************************************************
+  Title          : wtmp_merge.c
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Shows the records of several wtmp files merged in time
+                   order
+  Purpose        : To build one timeline from wtmp, its rotated archives
+                   wtmp.1 ... wtmp.N and btmp, without concatenating them
+  Usage          : wtmp_merge [--since TIME] [--until TIME] [--user NAME]
+                              [--line LINE] [--host HOST] [--type TYPE,...]
+                              [--or ...] file ...
+                   The options select the records to show, as in show_utmp,
+                   and the records are shown in the same form.
+  Build with     : gcc -o wtmp_merge wtmp_merge.c utmp_utils.c utmp_filter.c \
+                   -DSHOWHOST -I../include -L../lib -lutils -lz -lpthread
+
+  Notes          : Each file is read by its own utmp_reader through a buffer
+                   of MERGE_BUFSIZE bytes, so the memory used grows with the
+                   number of files, not with their sizes. The next record of
+                   each file is kept in a heap ordered by time, with ties
+                   going to the file named first; the earliest is shown and
+                   replaced by the next record from its file. Each file is
+                   assumed to be in time order already, as a wtmp file is
+                   apart from clock changes; records that are out of order
+                   within a file are shown in the order of that file.
+
+******************************************************************************
+ * Copyright (C) 2020 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <getopt.h>
+#include <utmp.h>
+#include "utmp_utils.h"
+#include "utmp_filter.h"
+#include "utils.h"
+
+#define MERGE_BUFSIZE  ( 256 * 1024 )   /* bytes per read() for each file */
+
+/* the next record of one file */
+typedef struct {
+    utmp_record  *rec;
+    int           file;         /* its position on the command line */
+} merge_entry;
+
+
+/*****************************************************************************
+  show info( struct utmp* )
+  displays contents of the utmp struct in human readable form
+ *****************************************************************************/
+void show_info(struct utmp *);
+
+
+/*****************************************************************************
+  show type( int )
+  displays string representing integer value of utmp type
+ *****************************************************************************/
+void show_type(int );
+
+
+/*****************************************************************************
+  earlier( a, b )
+  returns nonzero if the record of a comes before that of b
+ *****************************************************************************/
+static int earlier( merge_entry *, merge_entry * );
+
+
+/*****************************************************************************
+  sift down( heap, n, i )
+  moves the entry at i down the heap of n entries to where it belongs
+ *****************************************************************************/
+static void sift_down( merge_entry *, int, int );
+
+
+static struct option long_options[] = {
+    { "since",      required_argument, NULL, 's' },
+    { "until",      required_argument, NULL, 'u' },
+    { "user",       required_argument, NULL, 'U' },
+    { "line",       required_argument, NULL, 'L' },
+    { "host",       required_argument, NULL, 'H' },
+    { "type",       required_argument, NULL, 'T' },
+    { "or",         no_argument,       NULL, 'o' },
+    { NULL,         0,                 NULL,  0  }
+};
+
+
+/*****************************************************************************
+                               Main Program
+*****************************************************************************/
+int main(int argc, char* argv[])
+{
+    utmp_filter    *filter;         /* the records to show */
+    utmp_reader   **readers;        /* one for each file */
+    merge_entry    *heap;           /* the next record of each file */
+    time_t          since = LONG_MIN, until = LONG_MAX;
+    int             nfiles, n = 0, ch, i;
+    unsigned int    types;
+
+    if ( (filter = utmp_filter_new()) == NULL )
+        die("Out of memory", "");
+    while ( (ch = getopt_long(argc, argv, "", long_options, NULL)) != -1 ) {
+        switch ( ch ) {
+        case 's':
+        case 'u':
+            if ( utmp_filter_parse_time(optarg, ch == 's' ? &since : &until)
+                 == -1 ) {
+                fprintf(stderr, "bad time: %s\n", optarg);
+                exit(1);
+            }
+            utmp_filter_range(filter, since, until);
+            break;
+        case 'U':
+        case 'L':
+        case 'H':
+        case 'T':
+            if ( utmp_filter_add(filter, ch == 'U' ? UTMP_FILTER_USER :
+                                         ch == 'L' ? UTMP_FILTER_LINE :
+                                         ch == 'H' ? UTMP_FILTER_HOST :
+                                                     UTMP_FILTER_TYPE,
+                                 optarg) == -1 )
+                die("Bad filter value ", optarg);
+            break;
+        case 'o':
+            if ( utmp_filter_or(filter) == -1 )
+                die("Out of memory", "");
+            break;
+        default:
+            optind = argc;          /* to print the usage message */
+            break;
+        }
+    }
+    if ( (nfiles = argc - optind) < 1 ) {
+        fprintf(stderr, "usage: %s [--since TIME] [--until TIME]"
+                        " [--user NAME] [--line LINE] [--host HOST]"
+                        " [--type TYPE,...] [--or ...] file ...\n", argv[0]);
+        exit(1);
+    }
+
+    readers = malloc(nfiles * sizeof(utmp_reader *));
+    heap    = malloc(nfiles * sizeof(merge_entry));
+    if ( readers == NULL || heap == NULL )
+        die("Out of memory", "");
+
+    /* open every file and put its first wanted record in the heap */
+    types = utmp_filter_types(filter);
+    for ( i = 0; i < nfiles; i++ ) {
+        readers[i] = utmp_reader_open_flags(argv[optind + i], UTMP_NOMAP,
+                                            MERGE_BUFSIZE);
+        if ( readers[i] == NULL )
+            die("Cannot open ", argv[optind + i]);
+        utmp_reader_set_types(readers[i], types);
+        if ( (heap[n].rec = utmp_reader_next(readers[i])) != NULL_UTMP_RECORD_PTR ) {
+            heap[n].file = i;
+            n++;
+        }
+    }
+    for ( i = n / 2 - 1; i >= 0; i-- )
+        sift_down(heap, n, i);
+
+    /* show the earliest record, then replace it with the next from its file */
+    while ( n > 0 ) {
+        if ( utmp_filter_match(filter, heap[0].rec) )
+            show_info(heap[0].rec);
+        if ( (heap[0].rec = utmp_reader_next(readers[heap[0].file]))
+             == NULL_UTMP_RECORD_PTR )
+            heap[0] = heap[--n];
+        sift_down(heap, n, 0);
+    }
+
+    for ( i = 0; i < nfiles; i++ )
+        utmp_reader_close(readers[i]);
+    free(readers);
+    free(heap);
+    utmp_filter_free(filter);
+    return 0;
+}
+
+
+static int earlier( merge_entry *a, merge_entry *b )
+{
+    if ( a->rec->ut_tv.tv_sec != b->rec->ut_tv.tv_sec )
+        return a->rec->ut_tv.tv_sec < b->rec->ut_tv.tv_sec;
+    if ( a->rec->ut_tv.tv_usec != b->rec->ut_tv.tv_usec )
+        return a->rec->ut_tv.tv_usec < b->rec->ut_tv.tv_usec;
+    return a->file < b->file;
+}
+
+
+static void sift_down( merge_entry *heap, int n, int i )
+{
+    merge_entry  e = heap[i];
+    int          child;
+
+    while ( (child = 2 * i + 1) < n ) {
+        if ( child + 1 < n && earlier(&heap[child + 1], &heap[child]) )
+            child++;
+        if ( ! earlier(&heap[child], &e) )
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = e;
+}
+
+
+/*****************************************************************************
+  show info()
+  displays contents of the utmp struct in human readable form, exactly as
+  show_utmp does
+ *****************************************************************************/
+void show_info( struct utmp *utbufp )
+{
+    show_type(utbufp->ut_type);
+    put_field(utbufp->ut_name, sizeof(utbufp->ut_name), 8);  /* the logname */
+    put_char(' ');                          /* a space      */
+    put_field(utbufp->ut_line, sizeof(utbufp->ut_line), 8);  /* the tty     */
+    put_char(' ');                          /* a space      */
+    put_time( utbufp->ut_time );            /* display time */
+    put_char(' ');
+    put_long(utbufp->ut_exit.e_exit, -3);
+    put_char(' ');
+    put_long(utbufp->ut_exit.e_termination, -3);
+    put_char(' ');
+
+#ifdef SHOWHOST
+    if ( utbufp->ut_host[0] != '\0' ) {    /* the host     */
+        put_str(" (");
+        put_field(utbufp->ut_host, sizeof(utbufp->ut_host), 0);
+        put_char(')');
+    }
+#endif
+    put_char('\n');
+}
+
+
+/*****************************************************************************
+  show type( int )
+  displays string representing integer value of utmp type
+ *****************************************************************************/
+void show_type( int t)
+{
+    switch (t)
+    {
+    case RUN_LVL:      	put_str("RUN_LVL       "); break;
+    case BOOT_TIME:     put_str("BOOT_TIME     "); break;
+    case NEW_TIME:      put_str("NEW_TIME      "); break;
+    case OLD_TIME:      put_str("OLD_TIME      "); break;
+    case INIT_PROCESS:  put_str("INIT_PROCESS  "); break;
+    case LOGIN_PROCESS: put_str("LOGIN_PROCESS "); break;
+    case USER_PROCESS:  put_str("USER_PROCESS  "); break;
+    case DEAD_PROCESS:  put_str("DEAD_PROCESS  "); break;
+    case ACCOUNTING:    put_str("ACCOUNTING    "); break;
+    }
+}
@@ -0,0 +1,289 @@
+/******************************************************************************
+  Title          : wtmp_stats.c
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Counts logins per user, per host, per terminal and per day
+                   in a wtmp file
+  Purpose        : To demonstrate dividing the work of scanning a large file
+                   among several threads, each of which keeps its own tables,
+                   and combining their results at the end
+  Usage          : wtmp_stats [-t threads] [wtmp-file]
+                   where
+                       threads is the number of threads to use; it defaults
+                       to the number of online processors
+                       wtmp-file defaults to the system wtmp file
+  Build with     : gcc -o wtmp_stats wtmp_stats.c utmp_utils.c -I../include \
+                   -L../lib -lutils -lz -lpthread
+
+  Notes          : The file is split into ranges of whole records, one range
+                   per thread. Each thread opens its own utmp_reader, seeks
+                   to the start of its range and sets a limit at the end of
+                   it, so the threads share nothing while they scan. Because
+                   regular files are mapped, the readers all read the same
+                   page cache pages without copying them.
+
+                   Only USER_PROCESS records are counted; the readers are
+                   told to skip all others. Days are local calendar days.
+                   Users, hosts, terminals and days are counted in the
+                   count tables of ../utilities, which intern them and keep
+                   their counts in arrays indexed by their ids.
+
+******************************************************************************
+ * Copyright (C) 2020 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <utmp.h>
+#include "utmp_utils.h"
+#include "utils.h"
+
+#define BATCH_SIZE   1024     /* most records to take from a reader at once */
+
+/*
+   What each thread is given and what it produces; each thread has its own
+   count tables
+*/
+typedef struct {
+    const char  *file;
+    long         first;       /* index of first record in the range */
+    long         end;         /* index just past the range          */
+    count_table  users, hosts, lines, days;
+} chunk;
+
+
+void  *scan_chunk( void * );
+void   tables_init( chunk * );
+void   table_add( count_table *, const char *, size_t );
+void   tables_merge( chunk *, chunk * );
+void   tables_free( chunk * );
+void   print_table( const char *, count_table *, int );
+void   local_day( time_t, char *, size_t, time_t *, time_t * );
+
+
+/*****************************************************************************
+                               Main Program
+*****************************************************************************/
+int main(int argc, char* argv[])
+{
+    char         *file     = WTMP_FILE;
+    long          nthreads = sysconf( _SC_NPROCESSORS_ONLN );
+    long          nrecs, per_thread, i;
+    utmp_reader  *reader;
+    pthread_t    *tids;
+    chunk        *chunks;
+    chunk         total;
+    int           ch;
+
+    while ( (ch = getopt(argc, argv, "t:")) != -1 ) {
+        switch ( ch ) {
+        case 't':
+            nthreads = atol(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-t threads] [wtmp-file]\n", argv[0]);
+            exit(1);
+        }
+    }
+    if ( argc > optind )
+        file = argv[optind];
+    if ( nthreads < 1 )
+        nthreads = 1;
+
+    // find out how many records there are to divide up
+    if ( (reader = utmp_reader_open( file )) == NULL )
+        die( "Cannot open ", file );
+    nrecs = utmp_reader_count( reader );
+    utmp_reader_close( reader );
+    if ( nrecs < 0 ) {
+        // not a regular file, so it cannot be divided; one thread reads it
+        nthreads = 1;
+        nrecs    = -1;
+    }
+    else if ( nthreads > nrecs )
+        nthreads = nrecs > 0 ? nrecs : 1;
+
+    tids   = malloc( nthreads * sizeof(pthread_t) );
+    chunks = malloc( nthreads * sizeof(chunk) );
+    if ( tids == NULL || chunks == NULL )
+        die( "Out of memory", "" );
+
+    per_thread = nrecs < 0 ? -1 : ( nrecs + nthreads - 1 ) / nthreads;
+    for ( i = 0; i < nthreads; i++ ) {
+        chunks[i].file  = file;
+        chunks[i].first = nrecs < 0 ? 0 : i * per_thread;
+        chunks[i].end   = nrecs < 0 ? -1 : chunks[i].first + per_thread;
+        if ( nrecs >= 0 && chunks[i].end > nrecs )
+            chunks[i].end = nrecs;
+        if ( pthread_create( &tids[i], NULL, scan_chunk, &chunks[i] ) != 0 )
+            die( "Cannot create thread", "" );
+    }
+
+    tables_init( &total );
+    for ( i = 0; i < nthreads; i++ ) {
+        pthread_join( tids[i], NULL );
+        tables_merge( &total, &chunks[i] );
+    }
+
+    print_table( "Logins per user", &total.users, 1 );
+    print_table( "Logins per host", &total.hosts, 1 );
+    print_table( "Logins per terminal", &total.lines, 1 );
+    print_table( "Logins per day", &total.days, 0 );
+
+    tables_free( &total );
+    free( chunks );
+    free( tids );
+    return 0;
+}
+
+
+/*****************************************************************************
+  scan_chunk( chunk )
+  the start function of each thread: counts the logins in the chunk's range
+  of records into the chunk's own tables
+ *****************************************************************************/
+void *scan_chunk( void *arg )
+{
+    chunk        *c = arg;
+    utmp_reader  *reader;
+    utmp_record  *rec, *end;
+    int           count;
+    char          day[16];
+    time_t        day_start = 1, day_end = 0;   // empty window to start
+
+    tables_init( c );
+
+    if ( (reader = utmp_reader_open( c->file )) == NULL )
+        die( "Cannot open ", (char *) c->file );
+    if ( c->end >= 0 ) {
+        if ( utmp_reader_seek( reader, c->first ) == -1 )
+            die( "Cannot seek in ", (char *) c->file );
+        utmp_reader_set_limit( reader, c->end );
+    }
+    utmp_reader_set_types( reader, UTMP_TYPE_MASK( USER_PROCESS ) );
+
+    while ( (count = utmp_reader_next_batch( reader, &rec, BATCH_SIZE )) > 0 )
+        for ( end = rec + count; rec < end; rec++ ) {
+            table_add( &c->users, rec->ut_user, sizeof(rec->ut_user) );
+            table_add( &c->hosts, rec->ut_host, sizeof(rec->ut_host) );
+            table_add( &c->lines, rec->ut_line, sizeof(rec->ut_line) );
+
+            // the date only needs to be worked out again when the day changes
+            if ( rec->ut_tv.tv_sec < day_start || rec->ut_tv.tv_sec >= day_end )
+                local_day( rec->ut_tv.tv_sec, day, sizeof(day),
+                           &day_start, &day_end );
+            table_add( &c->days, day, strlen(day) );
+        }
+    utmp_reader_close( reader );
+    return NULL;
+}
+
+
+/*****************************************************************************
+  local_day( t, day, size, start, end )
+  puts the local date of t into day in the form YYYY-MM-DD, which sorts in
+  date order, and sets *start and *end to the first second of that day and
+  of the next, so that the caller can tell when a later time falls on the
+  same day without calling localtime_r() again
+ *****************************************************************************/
+void local_day( time_t t, char *day, size_t size, time_t *start, time_t *end )
+{
+    struct tm  tm;
+
+    localtime_r( &t, &tm );
+    strftime( day, size, "%Y-%m-%d", &tm );
+    tm.tm_sec = tm.tm_min = tm.tm_hour = 0;
+    tm.tm_isdst = -1;
+    *start = mktime( &tm );
+    tm.tm_mday++;
+    tm.tm_isdst = -1;
+    *end = mktime( &tm );
+}
+
+
+void tables_init( chunk *c )
+{
+    if ( count_table_init( &c->users ) == -1
+         || count_table_init( &c->hosts ) == -1
+         || count_table_init( &c->lines ) == -1
+         || count_table_init( &c->days ) == -1 )
+        die( "Out of memory", "" );
+}
+
+
+/*****************************************************************************
+  table_add( table, field, width )
+  adds one to the count of the key made of field's bytes up to its first
+  NUL or width bytes, whichever comes first
+ *****************************************************************************/
+void table_add( count_table *t, const char *field, size_t width )
+{
+    if ( count_table_add( t, field, width, 1 ) == -1 )
+        die( "Out of memory", "" );
+}
+
+
+/*****************************************************************************
+  tables_merge( into, from )
+  adds every count in from's tables to into's, then frees from's tables
+ *****************************************************************************/
+void tables_merge( chunk *into, chunk *from )
+{
+    if ( count_table_merge( &into->users, &from->users ) == -1
+         || count_table_merge( &into->hosts, &from->hosts ) == -1
+         || count_table_merge( &into->lines, &from->lines ) == -1
+         || count_table_merge( &into->days, &from->days ) == -1 )
+        die( "Out of memory", "" );
+    tables_free( from );
+}
+
+
+void tables_free( chunk *c )
+{
+    count_table_free( &c->users );
+    count_table_free( &c->hosts );
+    count_table_free( &c->lines );
+    count_table_free( &c->days );
+}
+
+
+/*****************************************************************************
+  print_table( title, table, sort_by_count )
+  prints the keys and counts in the table, largest count first if
+  sort_by_count is nonzero, otherwise in order of their keys
+ *****************************************************************************/
+void print_table( const char *title, count_table *t, int sort_by_count )
+{
+    count_entry  *entries;
+    int           i, n = count_table_size( t );
+
+    if ( (entries = count_table_sorted( t, sort_by_count )) == NULL )
+        die( "Out of memory", "" );
+
+    printf("%s:\n", title);
+    for ( i = 0; i < n; i++ )
+        printf("  %-32s %10ld\n", entries[i].key[0] ? entries[i].key : "(none)",
+               entries[i].count);
+    printf("\n");
+    free( entries );
+}
@@ -0,0 +1,251 @@
+/******************************************************************************
+  Title          : intern.c
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : A table that maps strings to small integer ids
+  Purpose        : For grouping records by a string field without comparing
+                   or copying the string each time
+  Usage          : see intern.h
+  Build with     : gcc -c intern.c
+
+  Notes          : The ids are found with an open-addressing hash table with
+                   linear probing whose slots hold only ids, and the hash of
+                   each string is kept beside it so that a probe compares
+                   strings only when the hashes agree. The hash is FNV-1a,
+                   computed in the same pass that finds the end of the field.
+                   The strings themselves are packed one after another into
+                   blocks of ARENA_BLOCK bytes, which are freed all together.
+
+******************************************************************************/
+
+
+/******************************************************************************
+ * Copyright (C) 2019 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "intern.h"
+
+#define ARENA_BLOCK   65536     /* bytes of strings per block       */
+#define START_SLOTS   64        /* initial size of the hash table   */
+
+/* one block of string storage; the strings follow the header */
+typedef struct arena_block {
+    struct arena_block  *next;
+} arena_block;
+
+typedef struct {
+    const char  *str;
+    uint32_t     len;
+    uint32_t     hash;
+} intern_entry;
+
+struct intern_table {
+    int32_t       *slots;       /* -1 if empty, else an id              */
+    size_t         nslots;      /* a power of 2                         */
+    intern_entry  *entries;     /* indexed by id                        */
+    int            count;
+    int            room;        /* entries that fit in entries          */
+    arena_block   *blocks;      /* newest first                         */
+    char          *free_space;  /* unused part of the newest block      */
+    size_t         free_len;
+};
+
+
+static size_t find_slot( intern_table *, const char *, size_t,
+                         uint32_t *, size_t * );
+static char  *arena_copy( intern_table *, const char *, size_t );
+static int    grow_slots( intern_table * );
+
+
+intern_table *intern_new( void )
+{
+    intern_table  *t;
+
+    if ( (t = calloc( 1, sizeof(intern_table) )) == NULL )
+        return NULL;
+    t->nslots = START_SLOTS;
+    if ( (t->slots = malloc( t->nslots * sizeof(int32_t) )) == NULL ) {
+        free( t );
+        return NULL;
+    }
+    memset( t->slots, 0xff, t->nslots * sizeof(int32_t) );
+    return t;
+}
+
+
+int intern_field( intern_table *t, const char *field, size_t width )
+{
+    uint32_t       h;
+    size_t         len, i, mask;
+    intern_entry  *e;
+    char          *copy;
+
+    i = find_slot( t, field, width, &h, &len );
+    if ( t->slots[i] != -1 )
+        return t->slots[i];
+
+    // a new string; keep the table at most half full
+    if ( (size_t) (t->count + 1) * 2 > t->nslots ) {
+        if ( grow_slots( t ) == -1 )
+            return -1;
+        mask = t->nslots - 1;
+        for ( i = h & mask; t->slots[i] != -1; i = (i + 1) & mask )
+            ;
+    }
+    if ( t->count == t->room ) {
+        int            room = t->room ? t->room * 2 : START_SLOTS / 2;
+        intern_entry  *bigger = realloc( t->entries, room * sizeof(intern_entry) );
+
+        if ( bigger == NULL )
+            return -1;
+        t->entries = bigger;
+        t->room    = room;
+    }
+    if ( (copy = arena_copy( t, field, len )) == NULL )
+        return -1;
+    e = &t->entries[t->count];
+    e->str  = copy;
+    e->len  = len;
+    e->hash = h;
+    t->slots[i] = t->count;
+    return t->count++;
+}
+
+
+int intern_lookup( intern_table *t, const char *field, size_t width )
+{
+    uint32_t  h;
+    size_t    len;
+
+    return t->slots[find_slot( t, field, width, &h, &len )];
+}
+
+
+const char *intern_name( intern_table *t, int id )
+{
+    if ( id < 0 || id >= t->count )
+        return NULL;
+    return t->entries[id].str;
+}
+
+
+int intern_count( intern_table *t )
+{
+    return t->count;
+}
+
+
+void intern_free( intern_table *t )
+{
+    arena_block  *b, *next;
+
+    if ( t == NULL )
+        return;
+    for ( b = t->blocks; b != NULL; b = next ) {
+        next = b->next;
+        free( b );
+    }
+    free( t->entries );
+    free( t->slots );
+    free( t );
+}
+
+
+/******************************************************************************
+  Hashes the field as intern_field() reads it and probes the hash table for
+  it. Stores the hash and length in *hash and *len and returns the slot that
+  holds the field's id, or else the empty slot where it would go.
+******************************************************************************/
+static size_t find_slot( intern_table *t, const char *field, size_t width,
+                         uint32_t *hash, size_t *len )
+{
+    uint32_t       h = 2166136261u;
+    size_t         n, i, mask = t->nslots - 1;
+    intern_entry  *e;
+
+    // hash the field and find its length in one pass
+    for ( n = 0; n < width && field[n] != '\0'; n++ )
+        h = ( h ^ (unsigned char) field[n] ) * 16777619u;
+
+    for ( i = h & mask; t->slots[i] != -1; i = (i + 1) & mask ) {
+        e = &t->entries[t->slots[i]];
+        if ( e->hash == h && e->len == n && memcmp( e->str, field, n ) == 0 )
+            break;
+    }
+    *hash = h;
+    *len  = n;
+    return i;
+}
+
+
+/******************************************************************************
+  Copies len bytes of str and a NUL into the newest block, starting a new
+  block first if there is not enough room left in it. Returns the copy, or
+  NULL if out of memory.
+******************************************************************************/
+static char *arena_copy( intern_table *t, const char *str, size_t len )
+{
+    arena_block  *b;
+    size_t        size;
+    char         *copy;
+
+    if ( len + 1 > t->free_len ) {
+        size = len + 1 > ARENA_BLOCK ? len + 1 : ARENA_BLOCK;
+        if ( (b = malloc( sizeof(arena_block) + size )) == NULL )
+            return NULL;
+        b->next       = t->blocks;
+        t->blocks     = b;
+        t->free_space = (char *) (b + 1);
+        t->free_len   = size;
+    }
+    copy = t->free_space;
+    memcpy( copy, str, len );
+    copy[len] = '\0';
+    t->free_space += len + 1;
+    t->free_len   -= len + 1;
+    return copy;
+}
+
+
+/******************************************************************************
+  Doubles the number of slots in the hash table and puts every id back in
+  it, using the saved hashes. Returns 0 on success, -1 if out of memory.
+******************************************************************************/
+static int grow_slots( intern_table *t )
+{
+    size_t    nslots = t->nslots * 2;
+    size_t    mask = nslots - 1;
+    int32_t  *slots;
+    size_t    i;
+    int       id;
+
+    if ( (slots = malloc( nslots * sizeof(int32_t) )) == NULL )
+        return -1;
+    memset( slots, 0xff, nslots * sizeof(int32_t) );
+    for ( id = 0; id < t->count; id++ ) {
+        for ( i = t->entries[id].hash & mask; slots[i] != -1; i = (i + 1) & mask )
+            ;
+        slots[i] = id;
+    }
+    free( t->slots );
+    t->slots  = slots;
+    t->nslots = nslots;
+    return 0;
+}
@@ -0,0 +1,81 @@
+#ifndef __INTERN_H__
+#define __INTERN_H__
+
+/******************************************************************************
+  Title          : intern.h
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Header file for intern.c
+  Purpose        : Maps strings, such as the fixed-width ut_user, ut_line and
+                   ut_host fields of utmp records, to small integer ids, so
+                   that a program can compare and count them by id
+
+ ******************************************************************************
+ * Copyright (C) 2019 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include <stddef.h>
+
+/******************************************************************************
+  An intern table gives each distinct string it is shown an id. The ids are
+  dense: they are 0, 1, 2, ... in the order the strings were first seen, so
+  they can be used directly as indices into arrays of counts or totals.
+  The strings are copied into large blocks of memory owned by the table;
+  interning a string that is already there allocates nothing.
+******************************************************************************/
+typedef struct intern_table intern_table;
+
+
+/******************************************************************************
+  Returns a new, empty intern table, or NULL if out of memory.
+******************************************************************************/
+intern_table *intern_new( void );
+
+/******************************************************************************
+  Returns the id of the string made of the bytes of field up to its first
+  NUL or the first width bytes, whichever is shorter, adding it to the table
+  if it is not there yet. The field need not be NUL-terminated, so a utmp
+  field can be passed as intern_field( t, rec->ut_user,
+  sizeof(rec->ut_user) ). Returns -1 if out of memory.
+******************************************************************************/
+int intern_field( intern_table *table, const char *field, size_t width );
+
+/******************************************************************************
+  Returns the id of the field, read as by intern_field(), if it is in the
+  table, or -1 if it is not. Never adds to the table or allocates memory.
+******************************************************************************/
+int intern_lookup( intern_table *table, const char *field, size_t width );
+
+/******************************************************************************
+  Returns the NUL-terminated string with the given id, or NULL if there is
+  no such id. The string belongs to the table and lasts as long as it does.
+******************************************************************************/
+const char *intern_name( intern_table *table, int id );
+
+/******************************************************************************
+  Returns the number of distinct strings in the table; their ids are 0 up to
+  one less than this.
+******************************************************************************/
+int intern_count( intern_table *table );
+
+/******************************************************************************
+  Frees the table and all of its strings.
+******************************************************************************/
+void intern_free( intern_table *table );
+
+
+#endif /* __INTERN_H__ */
@@ -0,0 +1,135 @@
+/******************************************************************************
+  Title          : intern_counts.c
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : A table of counts of strings, keyed by intern table ids
+  Purpose        : For counting records grouped by a string field, as by
+                   user, host or line
+  Usage          : see intern_counts.h
+  Build with     : gcc -c intern_counts.c
+
+  Notes          : Because intern table ids are dense, a key that is new to
+                   the table always gets the next id, so the array of counts
+                   only ever grows at its end. It is doubled when it fills.
+
+******************************************************************************/
+
+
+/******************************************************************************
+ * Copyright (C) 2019 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "intern.h"
+#include "intern_counts.h"
+
+
+static int by_count( const void *, const void * );
+static int by_key( const void *, const void * );
+
+
+int count_table_init( count_table *t )
+{
+    t->counts = NULL;
+    t->room   = 0;
+    return ( t->keys = intern_new() ) == NULL ? -1 : 0;
+}
+
+
+int count_table_add( count_table *t, const char *field, size_t width, long n )
+{
+    int    id = intern_field( t->keys, field, width );
+    int    room;
+    long  *bigger;
+
+    if ( id == -1 )
+        return -1;
+    if ( id >= t->room ) {
+        room = t->room ? t->room * 2 : 64;
+        if ( (bigger = realloc( t->counts, room * sizeof(long) )) == NULL )
+            return -1;
+        memset( bigger + id, 0, (room - id) * sizeof(long) );
+        t->counts = bigger;
+        t->room   = room;
+    }
+    t->counts[id] += n;
+    return id;
+}
+
+
+int count_table_merge( count_table *into, count_table *from )
+{
+    const char  *key;
+    int          id, n = intern_count( from->keys );
+
+    for ( id = 0; id < n; id++ ) {
+        key = intern_name( from->keys, id );
+        if ( count_table_add( into, key, strlen( key ), from->counts[id] ) == -1 )
+            return -1;
+    }
+    return 0;
+}
+
+
+int count_table_size( count_table *t )
+{
+    return intern_count( t->keys );
+}
+
+
+count_entry *count_table_sorted( count_table *t, int by_count_first )
+{
+    count_entry  *entries;
+    int           i, n = intern_count( t->keys );
+
+    if ( (entries = malloc( (n + 1) * sizeof(count_entry) )) == NULL )
+        return NULL;
+    for ( i = 0; i < n; i++ ) {
+        entries[i].key   = intern_name( t->keys, i );
+        entries[i].count = t->counts[i];
+    }
+    qsort( entries, n, sizeof(count_entry), by_count_first ? by_count : by_key );
+    return entries;
+}
+
+
+void count_table_free( count_table *t )
+{
+    intern_free( t->keys );
+    free( t->counts );
+    t->keys   = NULL;
+    t->counts = NULL;
+    t->room   = 0;
+}
+
+
+static int by_count( const void *a, const void *b )
+{
+    const count_entry *x = a, *y = b;
+
+    if ( x->count != y->count )
+        return x->count < y->count ? 1 : -1;
+    return strcmp( x->key, y->key );
+}
+
+
+static int by_key( const void *a, const void *b )
+{
+    return strcmp( ((const count_entry *) a)->key,
+                   ((const count_entry *) b)->key );
+}
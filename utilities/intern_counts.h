@@ -0,0 +1,92 @@
+#ifndef __INTERN_COUNTS_H__
+#define __INTERN_COUNTS_H__
+
+/******************************************************************************
+  Title          : intern_counts.h
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Header file for intern_counts.c
+  Purpose        : Counts how many times each string, such as the ut_user,
+                   ut_line or ut_host field of a utmp record, is seen, using
+                   an intern table to give the strings ids
+  Notes          : Include intern.h first; utils.h has them in that order.
+
+ ******************************************************************************
+ * Copyright (C) 2019 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include <stddef.h>
+
+/******************************************************************************
+  A count table keeps a count for each key it is given. The keys are
+  interned, and the counts are kept in an array indexed by the ids of the
+  keys, so adding to a key that has been seen before allocates nothing.
+  A table can be declared by value and set up with count_table_init().
+******************************************************************************/
+typedef struct {
+    intern_table  *keys;
+    long          *counts;      /* counts[id] is the count of key id */
+    int            room;        /* number of counts allocated        */
+} count_table;
+
+/* one key and its count, as returned by count_table_sorted() */
+typedef struct {
+    const char  *key;
+    long         count;
+} count_entry;
+
+
+/******************************************************************************
+  Makes the table empty. Returns 0, or -1 if out of memory.
+******************************************************************************/
+int count_table_init( count_table *table );
+
+/******************************************************************************
+  Adds n to the count of the key made of the bytes of field up to its first
+  NUL or the first width bytes, whichever is shorter, starting it at zero if
+  it is new. Returns the key's id, or -1 if out of memory.
+******************************************************************************/
+int count_table_add( count_table *table, const char *field, size_t width,
+                     long n );
+
+/******************************************************************************
+  Adds every count in from to the count of the same key in into. Returns 0,
+  or -1 if out of memory. from is not changed.
+******************************************************************************/
+int count_table_merge( count_table *into, count_table *from );
+
+/******************************************************************************
+  Returns the number of keys in the table.
+******************************************************************************/
+int count_table_size( count_table *table );
+
+/******************************************************************************
+  Returns a new array of the count_table_size() keys and their counts,
+  largest count first if by_count is nonzero, otherwise in order of their
+  keys; equal counts are in order of their keys. The keys belong to the
+  table; the array must be freed by the caller. Returns NULL if out of
+  memory.
+******************************************************************************/
+count_entry *count_table_sorted( count_table *table, int by_count );
+
+/******************************************************************************
+  Frees the table's keys and counts.
+******************************************************************************/
+void count_table_free( count_table *table );
+
+
+#endif /* __INTERN_COUNTS_H__ */
@@ -0,0 +1,177 @@
+/******************************************************************************
+  Title          : put_fields.c
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Buffered output of fixed-width fields
+  Purpose        : Replaces the several printf() calls per line of programs
+                   like who and show_utmp with plain copies into a buffer
+  Usage          : see put_fields.h
+  Build with     : gcc -c put_fields.c
+
+  Notes          : A printf() call parses its format, locks the stream and
+                   goes through several layers of stdio for every field.
+                   Here each field is copied and padded by hand into a
+                   static buffer that is written to file descriptor 1 with
+                   one write() when it fills and when the program exits.
+
+******************************************************************************/
+
+
+/******************************************************************************
+ * Copyright (C) 2019 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "put_fields.h"
+#include "show_time.h"
+
+#define PUT_BUFSIZE   65536
+
+static char    out_buf[PUT_BUFSIZE];
+static size_t  out_len    = 0;
+static int     registered = 0;     /* nonzero once put_flush() is set to run at exit */
+
+
+/******************************************************************************
+  Makes room for at least n more bytes in the buffer, which n must not
+  exceed, and returns where they go.
+******************************************************************************/
+static char *room_for( size_t n )
+{
+    if ( ! registered ) {
+        atexit( put_flush );
+        registered = 1;
+    }
+    if ( out_len + n > PUT_BUFSIZE )
+        put_flush();
+    return out_buf + out_len;
+}
+
+/******************************************************************************
+  Copies n bytes of s, which may be more than fit in the buffer.
+******************************************************************************/
+static void put_bytes( const char *s, size_t n )
+{
+    size_t  chunk;
+
+    while ( n > 0 ) {
+        chunk = n < PUT_BUFSIZE ? n : PUT_BUFSIZE;
+        memcpy( room_for( chunk ), s, chunk );
+        out_len += chunk;
+        s += chunk;
+        n -= chunk;
+    }
+}
+
+
+void put_str( const char *s )
+{
+    put_bytes( s, strlen( s ) );
+}
+
+
+void put_char( char c )
+{
+    *room_for( 1 ) = c;
+    out_len++;
+}
+
+
+void put_field( const char *field, size_t size, int width )
+{
+    size_t  len;
+    char   *p;
+
+    if ( width <= 0 ) {
+        put_bytes( field, strnlen( field, size ) );
+        return;
+    }
+    len = strnlen( field, size < (size_t) width ? size : (size_t) width );
+    p   = room_for( width );
+    memcpy( p, field, len );
+    memset( p + len, ' ', width - len );
+    out_len += width;
+}
+
+
+void put_rjust( const char *s, int width )
+{
+    size_t  len = strnlen( s, width );
+    char   *p   = room_for( width );
+
+    memset( p, ' ', width - len );
+    memcpy( p + width - len, s, len );
+    out_len += width;
+}
+
+
+void put_long( long n, int width )
+{
+    char           digits[24];
+    char          *d = digits + sizeof(digits);
+    unsigned long  u = n < 0 ? - (unsigned long) n : (unsigned long) n;
+    size_t         len, pad = 0;
+    char          *p;
+
+    do {
+        *--d = '0' + u % 10;
+        u /= 10;
+    } while ( u > 0 );
+    if ( n < 0 )
+        *--d = '-';
+    len = digits + sizeof(digits) - d;
+
+    if ( width < 0 ? (size_t) -width > len : (size_t) width > len )
+        pad = ( width < 0 ? (size_t) -width : (size_t) width ) - len;
+    p = room_for( len + pad );
+    if ( width > 0 ) {
+        memset( p, ' ', pad );
+        memcpy( p + pad, d, len );
+    }
+    else {
+        memcpy( p, d, len );
+        memset( p + len, ' ', pad );
+    }
+    out_len += len + pad;
+}
+
+
+void put_time( time_t timeval )
+{
+    put_rjust( get_date_no_day( timeval ), 12 );
+}
+
+
+void put_flush( void )
+{
+    char     *p = out_buf;
+    ssize_t   n;
+
+    while ( out_len > 0 ) {
+        if ( (n = write( 1, p, out_len )) == -1 ) {
+            if ( errno == EINTR )
+                continue;
+            break;          // as stdio does, give up on the output
+        }
+        p       += n;
+        out_len -= n;
+    }
+    out_len = 0;
+}
@@ -0,0 +1,72 @@
+#ifndef __PUT_FIELDS_H__
+#define __PUT_FIELDS_H__
+
+/******************************************************************************
+  Title          : put_fields.h
+  Author         : Stewart Weiss
+  Created on     : October 16, 2026
+  Description    : Header file for put_fields.c
+  Purpose        : Buffered output of fixed-width fields, for programs that
+                   print one line per record for a great many records
+
+ ******************************************************************************
+ * Copyright (C) 2019 - Stewart Weiss
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include <stddef.h>
+#include <time.h>
+
+/******************************************************************************
+  These functions append text to one large buffer for the standard output,
+  which is written with a single write() each time it fills. Each produces
+  exactly what the printf() format named beside it would, so a program can
+  switch to them without changing its output, but none of them parses a
+  format. The buffer is flushed when the program exits; a program that
+  waits for input in between must call put_flush() first.
+  Output written with these functions and output written with printf() do
+  not come out in the order they were written in, so a program should use
+  one or the other for its standard output.
+******************************************************************************/
+
+/* printf("%s", s) */
+void put_str( const char *s );
+
+/* printf("%c", c) */
+void put_char( char c );
+
+/******************************************************************************
+  printf("%-W.Ws", field) for width W, where field is a char array of size
+  bytes that is NUL-terminated only if it is shorter than that, such as the
+  ut_user member of a utmp struct. A width of 0 copies the whole field with
+  no padding, as "%.*s" with a precision of size would.
+******************************************************************************/
+void put_field( const char *field, size_t size, int width );
+
+/* printf("%W.Ws", s): right-justified in, and cut to, width characters */
+void put_rjust( const char *s, int width );
+
+/* printf("%*ld", width, n): a negative width left-justifies */
+void put_long( long n, int width );
+
+/* show_time( timeval ), that is, printf("%12.12s", get_date_no_day(timeval)) */
+void put_time( time_t timeval );
+
+/* writes out whatever is in the buffer */
+void put_flush( void );
+
+
+#endif /* __PUT_FIELDS_H__ */
@@ -30,6 +30,32 @@
 
 #include <time.h>
 #include <stdio.h>
+#include <string.h>
+#include "show_time.h"
+
+/*
+   get_date_no_day() keeps the strings for the local day of the last time it
+   formatted. Times in wtmp files come in order, so most of them fall on the
+   same day as the one before and are formatted from these strings with a
+   little arithmetic, without localtime() or strftime(). The window
+   [day_start, day_end) is that day, and is empty when nothing is cached.
+   day_c is strftime("%c") of a time in the day; in the C locale it looks
+   like "Thu Feb  4 00:46:40 1991", with the hours at HOUR_AT. day_old is
+   the "%b %e  %Y" form used for times more than six months ago.
+   The cache assumes that the time zone does not change while the program
+   runs. Each thread has its own cache, so get_date_no_day_r() can be
+   called from any number of threads at once.
+*/
+#define HOUR_AT  11
+
+static __thread time_t  day_start = 1;
+static __thread time_t  day_end   = 0;
+static __thread char    day_c[64];
+static __thread char    day_old[64];
+
+static char *format_date( struct tm *, int, char *, size_t );
+static int   fill_day_cache( time_t, struct tm * );
+static void  put_2digits( char *, long );
 
 
 
@@ -53,34 +79,142 @@
 
 char* get_date_no_day( time_t timeval )
 {
-    const int  sixmonths = 15724800; /* number of secs in 6 months */
     static char outstr[200];
-    struct tm *tmp;
-    time_t current_time = time(NULL);
+
+    return get_date_no_day_r(timeval, time(NULL), outstr, sizeof(outstr));
+}
+
+
+/******************************************************************************
+  The reentrant form of get_date_no_day(): the date is written into outstr,
+  which holds size bytes, and is recent or not according to the time now
+  given by the caller, who can call time() once for many dates.
+  Returns a pointer to the date, which is within outstr but not always at
+  its start.
+******************************************************************************/
+char* get_date_no_day_r( time_t timeval, time_t now, char *outstr,
+                         size_t size )
+{
+    const int  sixmonths = 15724800; /* number of secs in 6 months */
+    struct tm  tm;
     int    recent = 1;
+    long   secs;
 
-    if ( ( current_time - timeval ) > sixmonths )
+    if ( ( now - timeval ) > sixmonths )
         recent = 0;
 
-    tmp = localtime(&timeval);
-    if (tmp == NULL) {
-        perror("get_date_no_day: localtime");
+    if ( timeval < day_start || timeval >= day_end ) {
+        if ( localtime_r(&timeval, &tm) == NULL ) {
+            perror("get_date_no_day: localtime");
+            outstr[0] = '\0';
+            return outstr;
+        }
+        if ( ! fill_day_cache(timeval, &tm) )
+            return format_date(&tm, recent, outstr, size);
+    }
+
+    if ( ! recent ) {
+        if ( strlen(day_old) >= size )
+            goto slow;
+        strcpy(outstr, day_old);
+        return outstr;
     }
-    
+    /* the date part is the same all day; only the clock digits change */
+    if ( strlen(day_c) >= size )
+        goto slow;
+    strcpy(outstr, day_c);
+    secs = timeval - day_start;
+    put_2digits(outstr + HOUR_AT, secs / 3600);
+    put_2digits(outstr + HOUR_AT + 3, secs / 60 % 60);
+    put_2digits(outstr + HOUR_AT + 6, secs % 60);
+    return outstr+4;
+
+slow:
+    localtime_r(&timeval, &tm);
+    return format_date(&tm, recent, outstr, size);
+}
+
+
+/******************************************************************************
+  Formats the broken-down time tm the way get_date_no_day() always did, by
+  calling strftime().
+******************************************************************************/
+static char *format_date( struct tm *tmp, int recent, char *outstr, size_t size )
+{
     if ( ! recent ) {
-        strftime(outstr, sizeof(outstr), "%b %e  %Y", tmp);
+        strftime(outstr, size, "%b %e  %Y", tmp);
         return outstr;
     }
-    else if (strftime(outstr, sizeof(outstr), "%c", tmp) > 0) 
+    else if (strftime(outstr, size, "%c", tmp) > 0)
         return outstr+4;
     else {
         printf("error with strftime\n");
-        strftime(outstr, sizeof(outstr), "%b %e %H:%M", tmp);
+        strftime(outstr, size, "%b %e %H:%M", tmp);
         return outstr;
     }
+}
+
+
+/******************************************************************************
+  Makes the local day that contains timeval, whose broken-down time is tm,
+  the cached day: sets day_start and day_end to its first second and the
+  first second of the next day, and formats its dates. Only an ordinary day
+  is cached: one that is exactly 24 hours long with one UTC offset
+  throughout, and whose "%c" string has the hours, minutes and seconds at
+  HOUR_AT, as it does in the C locale. Every second of such a day is
+  formatted correctly by copying the cached strings and filling in the
+  clock from the seconds since midnight.
+  Returns 1 if the day was cached, 0 if not, in which case the cache is
+  left empty.
+******************************************************************************/
+static int fill_day_cache( time_t timeval, struct tm *tm )
+{
+    struct tm  day, last;
+    time_t     start, end, end_of_day;
+    char       check[9];
+
+    day_start = 1;
+    day_end   = 0;
+
+    day = *tm;
+    day.tm_sec = day.tm_min = day.tm_hour = 0;
+    day.tm_isdst = -1;
+    start = mktime(&day);
+    day = *tm;
+    day.tm_sec = day.tm_min = day.tm_hour = 0;
+    day.tm_mday++;
+    day.tm_isdst = -1;
+    end = mktime(&day);
+    if ( start == -1 || end == -1 || end - start != 86400
+         || timeval < start || timeval >= end )
+        return 0;
+    end_of_day = end - 1;
+    if ( localtime_r(&start, &day) == NULL || day.tm_hour != 0
+         || localtime_r(&end_of_day, &last) == NULL
+         || day.tm_gmtoff != tm->tm_gmtoff || last.tm_gmtoff != tm->tm_gmtoff )
+        return 0;
+
+    if ( strftime(day_c, sizeof(day_c), "%c", tm) < HOUR_AT + 8
+         || strftime(day_old, sizeof(day_old), "%b %e  %Y", tm) == 0 )
+        return 0;
+    strftime(check, sizeof(check), "%H:%M:%S", tm);
+    if ( strncmp(day_c + HOUR_AT, check, 8) != 0 )
+        return 0;
+
+    day_start = start;
+    day_end   = end;
+    return 1;
+}
+
 
+/* writes n, from 0 to 99, as two digits */
+static void put_2digits( char *p, long n )
+{
+    p[0] = '0' + n / 10;
+    p[1] = '0' + n % 10;
 }
 
+
 /******************************************************************************
   Convert the given time value into a date in the format 
         "Feb  4 00:46:40"
@@ -94,6 +228,22 @@ void show_time( time_t timeval )
 }
 
 
+/******************************************************************************
+  The reentrant form of show_time(): instead of printing the date, puts
+  exactly the 12 characters show_time() would print, and a NUL, into
+  outstr, which must hold at least 13 bytes. now is as for
+  get_date_no_day_r(). Returns outstr.
+******************************************************************************/
+char* show_time_r( time_t timeval, time_t now, char *outstr, size_t size )
+{
+    char  date[64];
+
+    snprintf(outstr, size, "%12.12s",
+             get_date_no_day_r(timeval, now, date, sizeof(date)));
+    return outstr;
+}
+
+
 /******************************************************************************
   Given a time_t now, returns a new time_t by adding the days
   hours, minutes, and seconds specified
@@ -9,6 +9,8 @@
   Purpose        : Displays date in format "Feb  4 00:46:40 EST 1991"
   Modified on    : March 1, 2011
                    added functions time_plus() and time_minus()
+                   October 16, 2026
+                   added functions get_date_no_day_r() and show_time_r()
  
  ******************************************************************************
  * Copyright (C) 2019 - Stewart Weiss
@@ -28,6 +30,7 @@
 
 ******************************************************************************/
 
+#include <stddef.h>
 #include <time.h>
 
 
@@ -40,6 +43,16 @@
 ******************************************************************************/
 char* get_date_no_day( time_t timeval );
 
+/******************************************************************************
+  The same as get_date_no_day(), but safe to call from several threads at
+  once. The date is written into outstr, which holds size bytes, and the
+  return value points to it within outstr. Whether the date is recent is
+  decided from now, which the caller gets from time() once and passes in
+  for many calls, instead of from the current time.
+******************************************************************************/
+char* get_date_no_day_r( time_t timeval, time_t now, char *outstr,
+                         size_t size );
+
 
 
 /******************************************************************************
@@ -50,6 +63,15 @@ char* get_date_no_day( time_t timeval );
 ******************************************************************************/
 void show_time( time_t timeval );
 
+/******************************************************************************
+  The same as show_time(), but safe to call from several threads at once:
+  the 12 characters that show_time() would print are written into outstr,
+  with a NUL after them, instead of to the standard output. outstr holds
+  size bytes, which should be at least 13. now is as for
+  get_date_no_day_r(). Returns outstr.
+******************************************************************************/
+char* show_time_r( time_t timeval, time_t now, char *outstr, size_t size );
+
 
 /******************************************************************************
   Given a time_t now, returns a new time_t by adding the days